@@ -32,6 +32,7 @@ struct _MetaCompositor
   guint           show_redraw : 1;
   guint           debug       : 1;
   guint           no_mipmaps  : 1;
+  guint           draw_decorations : 1;
 };
 
 struct _MetaCompScreen
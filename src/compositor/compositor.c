@@ -884,6 +884,35 @@ meta_compositor_window_shape_changed (MetaCompositor *compositor,
   meta_window_actor_update_shape (window_actor);
 }
 
+/**
+ * meta_compositor_queue_decorations_redraw:
+ * @compositor: A #MetaCompositor
+ * @window: A decorated #MetaWindow
+ *
+ * When MUTTER_COMPOSITOR_DECORATIONS is set, the window's frame is drawn
+ * by its #MetaWindowActor rather than into the frame's X window. This
+ * queues that drawing.
+ *
+ * Return value: %TRUE if the compositor draws the frame of @window, in
+ * which case it shouldn't be drawn into the X window as well.
+ */
+gboolean
+meta_compositor_queue_decorations_redraw (MetaCompositor *compositor,
+                                          MetaWindow     *window)
+{
+  MetaWindowActor *window_actor;
+
+  if (!compositor->draw_decorations)
+    return FALSE;
+
+  window_actor = META_WINDOW_ACTOR (meta_window_get_compositor_private (window));
+  if (!window_actor)
+    return FALSE;
+
+  meta_window_actor_queue_decorations_redraw (window_actor);
+  return TRUE;
+}
+
 /* Clutter makes the assumption that there is only one X window
  * per stage, which is a valid assumption to make for a generic
  * application toolkit. As such, it will ignore any events sent
@@ -1533,6 +1562,9 @@ meta_compositor_new (MetaDisplay *display)
   if (g_getenv("META_DISABLE_MIPMAPS"))
     compositor->no_mipmaps = TRUE;
 
+  if (g_getenv ("MUTTER_COMPOSITOR_DECORATIONS"))
+    compositor->draw_decorations = TRUE;
+
   meta_verbose ("Creating %d atoms\n", (int) G_N_ELEMENTS (atom_names));
   XInternAtoms (xdisplay, atom_names, G_N_ELEMENTS (atom_names),
                 False, atoms);
@@ -44,6 +44,29 @@ enum {
 
 static guint signals[LAST_SIGNAL] = {0};
 
+/* The frame drawn by the compositor is split into the four borders
+ * around the client, so that only the frame itself gets a texture.
+ */
+enum {
+  DECORATION_TOP,
+  DECORATION_BOTTOM,
+  DECORATION_LEFT,
+  DECORATION_RIGHT,
+  N_DECORATION_PIECES
+};
+
+typedef struct
+{
+  MetaWindowActor       *window_actor;
+  ClutterActor          *actor;
+
+  /* Where the piece is, in frame window coordinates */
+  cairo_rectangle_int_t  rect;
+
+  /* The frame mask over rect; kept until the piece changes size */
+  cairo_surface_t       *mask;
+} MetaDecorationPiece;
+
 
 struct _MetaWindowActorPrivate
 {
@@ -53,6 +76,12 @@ struct _MetaWindowActorPrivate
 
   ClutterActor     *actor;
 
+  /* The frame, drawn by us rather than into the frame's X window;
+   * see meta_compositor_queue_decorations_redraw(). Only created in
+   * that mode, as an array of N_DECORATION_PIECES.
+   */
+  MetaDecorationPiece *decorations;
+
   /* MetaShadowFactory only caches shadows that are actually in use;
    * to avoid unnecessary recomputation we do two things: 1) we store
    * both a focused and unfocused shadow for the window. If the window
@@ -402,6 +431,16 @@ meta_window_actor_constructed (GObject *object)
        * Just ensure the actor is top most (i.e., above shadow).
        */
       clutter_actor_set_child_above_sibling (CLUTTER_ACTOR (self), priv->actor, NULL);
+
+      if (priv->decorations)
+        {
+          int i;
+
+          for (i = 0; i < N_DECORATION_PIECES; i++)
+            clutter_actor_set_child_above_sibling (CLUTTER_ACTOR (self),
+                                                   priv->decorations[i].actor,
+                                                   NULL);
+        }
     }
 
   meta_window_actor_update_opacity (self);
@@ -459,6 +498,20 @@ meta_window_actor_dispose (GObject *object)
   g_clear_pointer (&priv->unfocused_shadow, meta_shadow_unref);
   g_clear_pointer (&priv->shadow_shape, meta_window_shape_unref);
 
+  if (priv->decorations)
+    {
+      int i;
+
+      /* The canvases point into the array */
+      for (i = 0; i < N_DECORATION_PIECES; i++)
+        {
+          clutter_actor_destroy (priv->decorations[i].actor);
+          g_clear_pointer (&priv->decorations[i].mask, cairo_surface_destroy);
+        }
+
+      g_clear_pointer (&priv->decorations, g_free);
+    }
+
   if (priv->damage != None)
     {
       meta_error_trap_push (display);
@@ -1546,6 +1599,9 @@ meta_window_actor_sync_actor_geometry (MetaWindowActor *self,
     {
       meta_window_actor_queue_create_pixmap (self);
       meta_window_actor_update_shape (self);
+
+      if (priv->decorations)
+        meta_window_actor_queue_decorations_redraw (self);
     }
 
   if (meta_window_actor_effect_in_progress (self))
@@ -2281,6 +2337,17 @@ build_and_scan_frame_mask (MetaWindowActor       *self,
       cairo_region_union (shape_region, scanned_region);
       cairo_region_destroy (scanned_region);
       cairo_region_destroy (frame_paint_region);
+
+      /* When we draw the frame ourselves, nothing is drawn into the
+       * frame window, so only the client area of its pixmap may show.
+       * The frame still counts towards the shape, for the shadow.
+       */
+      if (priv->decorations)
+        {
+          cairo_set_operator (cr, CAIRO_OPERATOR_CLEAR);
+          cairo_paint (cr);
+          cairo_surface_flush (surface);
+        }
     }
 
   cairo_destroy (cr);
@@ -2454,6 +2521,167 @@ check_needs_reshape (MetaWindowActor *self)
   priv->needs_reshape = FALSE;
 }
 
+static gboolean
+draw_decoration_piece (ClutterCanvas       *canvas,
+                       cairo_t             *cr,
+                       int                  width,
+                       int                  height,
+                       MetaDecorationPiece *piece)
+{
+  MetaWindowActorPrivate *priv = piece->window_actor->priv;
+  MetaFrame *frame = priv->window->frame;
+
+  cairo_save (cr);
+  cairo_set_operator (cr, CAIRO_OPERATOR_CLEAR);
+  cairo_paint (cr);
+  cairo_restore (cr);
+
+  if (frame == NULL)
+    return TRUE;
+
+  /* Themes don't draw the rounded corners themselves, they rely on the
+   * frame mask for that, as build_and_scan_frame_mask() does. The mask
+   * only covers this piece, and is built once per size.
+   */
+  if (piece->mask == NULL)
+    {
+      cairo_t *mask_cr;
+
+      piece->mask = cairo_image_surface_create (CAIRO_FORMAT_A8, width, height);
+      mask_cr = cairo_create (piece->mask);
+      cairo_translate (mask_cr, -piece->rect.x, -piece->rect.y);
+      meta_frame_get_mask (frame, mask_cr);
+      cairo_destroy (mask_cr);
+    }
+
+  cairo_save (cr);
+  cairo_translate (cr, -piece->rect.x, -piece->rect.y);
+  meta_frame_paint (frame, cr);
+  cairo_restore (cr);
+
+  cairo_set_operator (cr, CAIRO_OPERATOR_DEST_IN);
+  cairo_set_source_surface (cr, piece->mask, 0, 0);
+  cairo_paint (cr);
+
+  return TRUE;
+}
+
+static void
+create_decorations (MetaWindowActor *self)
+{
+  MetaWindowActorPrivate *priv = self->priv;
+  int i;
+
+  priv->decorations = g_new0 (MetaDecorationPiece, N_DECORATION_PIECES);
+
+  for (i = 0; i < N_DECORATION_PIECES; i++)
+    {
+      MetaDecorationPiece *piece = &priv->decorations[i];
+      ClutterContent *canvas;
+
+      piece->window_actor = self;
+
+      canvas = clutter_canvas_new ();
+      g_signal_connect (canvas, "draw",
+                        G_CALLBACK (draw_decoration_piece), piece);
+
+      piece->actor = clutter_actor_new ();
+      clutter_actor_set_content (piece->actor, canvas);
+      g_object_unref (canvas);
+
+      clutter_actor_add_child (CLUTTER_ACTOR (self), piece->actor);
+      clutter_actor_set_child_above_sibling (CLUTTER_ACTOR (self),
+                                             piece->actor, priv->actor);
+    }
+
+  /* The frame window's part of the pixmap has to go from the shaped
+   * texture now
+   */
+  meta_window_actor_update_shape (self);
+}
+
+static void
+update_decoration_piece (MetaDecorationPiece *piece,
+                         int                  x,
+                         int                  y,
+                         int                  width,
+                         int                  height)
+{
+  ClutterContent *canvas = clutter_actor_get_content (piece->actor);
+
+  width = MAX (width, 0);
+  height = MAX (height, 0);
+
+  piece->rect.x = x;
+  piece->rect.y = y;
+
+  if (piece->rect.width != width || piece->rect.height != height)
+    {
+      piece->rect.width = width;
+      piece->rect.height = height;
+      g_clear_pointer (&piece->mask, cairo_surface_destroy);
+    }
+
+  clutter_actor_set_position (piece->actor, x, y);
+  clutter_actor_set_size (piece->actor, width, height);
+
+  if (width == 0 || height == 0)
+    {
+      clutter_actor_hide (piece->actor);
+      return;
+    }
+
+  clutter_actor_show (piece->actor);
+
+  /* Setting a new size invalidates the canvas already */
+  if (!clutter_canvas_set_size (CLUTTER_CANVAS (canvas), width, height))
+    clutter_content_invalidate (canvas);
+}
+
+/**
+ * meta_window_actor_queue_decorations_redraw: (skip)
+ * @self: A #MetaWindowActor
+ *
+ * Redraws the frame of the window into textures of our own, one for
+ * each border around the client, creating them the first time.
+ */
+void
+meta_window_actor_queue_decorations_redraw (MetaWindowActor *self)
+{
+  MetaWindowActorPrivate *priv = self->priv;
+  MetaFrameBorders borders;
+  MetaRectangle window_rect;
+  int client_width, client_height;
+  int bottom_y, right_x;
+
+  if (priv->window->frame == NULL)
+    return;
+
+  if (priv->decorations == NULL)
+    create_decorations (self);
+
+  meta_window_get_input_rect (priv->window, &window_rect);
+  meta_frame_calc_borders (priv->window->frame, &borders);
+
+  client_width = priv->window->rect.width;
+  client_height = priv->window->shaded ? 0 : priv->window->rect.height;
+  bottom_y = borders.total.top + client_height;
+  right_x = borders.total.left + client_width;
+
+  update_decoration_piece (&priv->decorations[DECORATION_TOP],
+                           0, 0,
+                           window_rect.width, borders.total.top);
+  update_decoration_piece (&priv->decorations[DECORATION_BOTTOM],
+                           0, bottom_y,
+                           window_rect.width, window_rect.height - bottom_y);
+  update_decoration_piece (&priv->decorations[DECORATION_LEFT],
+                           0, borders.total.top,
+                           borders.total.left, client_height);
+  update_decoration_piece (&priv->decorations[DECORATION_RIGHT],
+                           right_x, borders.total.top,
+                           window_rect.width - right_x, client_height);
+}
+
 void
 meta_window_actor_update_shape (MetaWindowActor *self)
 {
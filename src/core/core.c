@@ -117,10 +117,10 @@ meta_core_get (Display *xdisplay,
         *((MetaFrameType*)answer) = meta_window_get_frame_type (window);
         break;
       case META_CORE_GET_MINI_ICON:
-        *((GdkPixbuf**)answer) = window->mini_icon;
+        *((GdkPixbuf**)answer) = meta_window_get_mini_icon (window);
         break;
       case META_CORE_GET_ICON:
-        *((GdkPixbuf**)answer) = window->icon;
+        *((GdkPixbuf**)answer) = meta_window_get_icon (window);
         break;
       case META_CORE_GET_X:
         meta_window_get_position (window, (int*)answer, NULL);
@@ -173,6 +173,19 @@ meta_core_queue_frame_resize (Display *xdisplay,
   meta_window_queue (window, META_QUEUE_MOVE_RESIZE);
 }
 
+gboolean
+meta_core_queue_decorations_redraw (Display *xdisplay,
+                                    Window   frame_xwindow)
+{
+  MetaWindow *window = get_window (xdisplay, frame_xwindow);
+
+  if (window->display->compositor == NULL)
+    return FALSE;
+
+  return meta_compositor_queue_decorations_redraw (window->display->compositor,
+                                                   window);
+}
+
 void
 meta_core_user_move (Display *xdisplay,
                      Window   frame_xwindow,
@@ -769,7 +782,7 @@ meta_invalidate_default_icons (void)
       if (window->icon_cache.origin == USING_FALLBACK_ICON)
         {
           meta_icon_cache_free (&(window->icon_cache));
-          meta_window_update_icon_now (window);
+          meta_window_queue (window, META_QUEUE_UPDATE_ICON);
         }
     }
 
@@ -95,6 +95,10 @@ void meta_core_get (Display *xdisplay,
 void meta_core_queue_frame_resize (Display *xdisplay,
                                    Window frame_xwindow);
 
+/* Returns TRUE if the compositor draws this frame itself */
+gboolean meta_core_queue_decorations_redraw (Display *xdisplay,
+                                             Window   frame_xwindow);
+
 /* Move as a result of user operation */
 void meta_core_user_move    (Display *xdisplay,
                              Window   frame_xwindow,
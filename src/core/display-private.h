@@ -190,6 +190,12 @@ struct _MetaDisplay
   guint       autoraise_timeout_id;
   MetaWindow* autoraise_window;
 
+  /* Windows that weren't showing when the theme changed; they are
+   * rethemed a few at a time from an idle
+   */
+  GList      *retheme_windows;
+  guint       retheme_later;
+
   /* Alt+click button grabs */
   unsigned int window_grab_modifiers;
   
@@ -437,6 +443,8 @@ const char* meta_event_mode_to_string   (int m);
 const char* meta_event_detail_to_string (int d);
 
 void meta_display_queue_retheme_all_windows (MetaDisplay *display);
+void meta_display_unqueue_retheme (MetaDisplay *display,
+                                   MetaWindow  *window);
 void meta_display_retheme_all (void);
 
 void meta_display_set_cursor_theme (const char *theme, 
@@ -192,8 +192,8 @@ static void    process_selection_clear   (MetaDisplay   *display,
 
 static void    update_window_grab_modifiers (MetaDisplay *display);
 
-static void    prefs_changed_callback    (MetaPreference pref,
-                                          void          *data);
+static void    prefs_changed_callback    (MetaPrefsChanges changes,
+                                          void            *data);
 
 static void    sanity_check_timestamps   (MetaDisplay *display,
                                           guint32      known_good_timestamp);
@@ -560,7 +560,7 @@ meta_display_open (void)
 
   update_window_grab_modifiers (the_display);
 
-  meta_prefs_add_listener (prefs_changed_callback, the_display);
+  meta_prefs_add_changes_listener (prefs_changed_callback, the_display);
 
   meta_verbose ("Creating %d atoms\n", (int) G_N_ELEMENTS (atom_names));
   XInternAtoms (the_display->xdisplay, atom_names, G_N_ELEMENTS (atom_names),
@@ -1091,10 +1091,31 @@ meta_display_close (MetaDisplay *display,
 
   display->closing += 1;
 
-  meta_prefs_remove_listener (prefs_changed_callback, display);
+  meta_prefs_remove_changes_listener (prefs_changed_callback, display);
   
   meta_display_remove_autoraise_callback (display);
 
+  if (display->retheme_windows)
+    {
+      GList *l;
+
+      for (l = display->retheme_windows; l; l = l->next)
+        {
+          MetaWindow *window = l->data;
+
+          window->retheme_queued = FALSE;
+        }
+
+      g_list_free (display->retheme_windows);
+      display->retheme_windows = NULL;
+    }
+
+  if (display->retheme_later != 0)
+    {
+      meta_later_remove (display->retheme_later);
+      display->retheme_later = 0;
+    }
+
   if (display->focus_timeout_id)
     g_source_remove (display->focus_timeout_id);
   display->focus_timeout_id = 0;
@@ -1119,6 +1140,11 @@ meta_display_close (MetaDisplay *display,
   g_slist_free (display->screens);
   display->screens = NULL;
 
+  /* Monitor configuration changes are saved with a delay, write out
+   * the ones still waiting before we exit
+   */
+  meta_monitor_config_flush (meta_monitor_manager_get ()->config);
+
 #ifdef HAVE_STARTUP_NOTIFICATION
   if (display->sn_display)
     {
@@ -4638,6 +4664,72 @@ meta_display_update_active_window_hint (MetaDisplay *display)
     }
 }
 
+/* How long one round of retheming offscreen windows may take, in
+ * microseconds
+ */
+#define RETHEME_BUDGET_USEC 4000
+
+static gboolean
+retheme_windows_idle (gpointer data)
+{
+  MetaDisplay *display = data;
+  GList *showing = NULL;
+  GList *hidden = NULL;
+  GList *l;
+  gint64 deadline;
+  int n_rethemed = 0;
+
+  /* Windows that have come on screen since the theme changed go first */
+  for (l = display->retheme_windows; l; l = l->next)
+    {
+      if (meta_window_should_be_showing (l->data))
+        showing = g_list_prepend (showing, l->data);
+      else
+        hidden = g_list_prepend (hidden, l->data);
+    }
+
+  g_list_free (display->retheme_windows);
+  display->retheme_windows = g_list_concat (g_list_reverse (showing),
+                                            g_list_reverse (hidden));
+
+  deadline = g_get_monotonic_time () + RETHEME_BUDGET_USEC;
+
+  while (display->retheme_windows)
+    {
+      MetaWindow *window = display->retheme_windows->data;
+
+      display->retheme_windows = g_list_delete_link (display->retheme_windows,
+                                                     display->retheme_windows);
+      window->retheme_queued = FALSE;
+
+      meta_window_retheme (window);
+      n_rethemed++;
+
+      if (g_get_monotonic_time () >= deadline)
+        break;
+    }
+
+  meta_topic (META_DEBUG_THEMES, "Rethemed %d windows, %s\n", n_rethemed,
+              display->retheme_windows ? "more to do" : "done");
+
+  if (display->retheme_windows == NULL)
+    {
+      display->retheme_later = 0;
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+/**
+ * meta_display_queue_retheme_all_windows:
+ * @display: a #MetaDisplay
+ *
+ * Recomputes the frames of all windows after a change to the theme.
+ * Windows that are showing are done before the next redraw. The others
+ * are done from an idle, a few milliseconds' worth at a time, so that
+ * the session doesn't freeze while hundreds of them are done at once.
+ */
 void
 meta_display_queue_retheme_all_windows (MetaDisplay *display)
 {
@@ -4649,17 +4741,45 @@ meta_display_queue_retheme_all_windows (MetaDisplay *display)
   while (tmp != NULL)
     {
       MetaWindow *window = tmp->data;
-      
-      meta_window_queue (window, META_QUEUE_MOVE_RESIZE);
-      if (window->frame)
+
+      if (meta_window_should_be_showing (window))
         {
-          meta_frame_queue_draw (window->frame);
+          meta_window_queue (window, META_QUEUE_MOVE_RESIZE);
+          if (window->frame)
+            {
+              meta_frame_queue_draw (window->frame);
+            }
         }
-      
+      else if (!window->retheme_queued)
+        {
+          display->retheme_windows = g_list_prepend (display->retheme_windows,
+                                                     window);
+          window->retheme_queued = TRUE;
+        }
+
       tmp = tmp->next;
     }
 
   g_slist_free (windows);
+
+  if (display->retheme_windows && display->retheme_later == 0)
+    display->retheme_later = meta_later_add (META_LATER_IDLE,
+                                             retheme_windows_idle,
+                                             display, NULL);
+}
+
+void
+meta_display_unqueue_retheme (MetaDisplay *display,
+                              MetaWindow  *window)
+{
+  display->retheme_windows = g_list_remove (display->retheme_windows, window);
+  window->retheme_queued = FALSE;
+
+  if (display->retheme_windows == NULL && display->retheme_later != 0)
+    {
+      meta_later_remove (display->retheme_later);
+      display->retheme_later = 0;
+    }
 }
 
 void
@@ -5679,8 +5799,8 @@ update_window_grab_modifiers (MetaDisplay *display)
 }
 
 static void
-prefs_changed_callback (MetaPreference pref,
-                        void          *data)
+prefs_changed_callback (MetaPrefsChanges changes,
+                        void            *data)
 {
   MetaDisplay *display = data;
   
@@ -5688,10 +5808,9 @@ prefs_changed_callback (MetaPreference pref,
    * change; it's because we handle focus clicks a
    * bit differently for the different focus modes.
    */
-  if (pref == META_PREF_MOUSE_BUTTON_MODS ||
-      pref == META_PREF_FOCUS_MODE)
+  if (META_PREFS_CHANGED (changes, META_PREF_MOUSE_BUTTON_MODS) ||
+      META_PREFS_CHANGED (changes, META_PREF_FOCUS_MODE))
     {
-      MetaDisplay *display = data;
       GSList *windows;
       GSList *tmp;
       
@@ -5708,7 +5827,7 @@ prefs_changed_callback (MetaPreference pref,
         }
 
       /* change our modifier */
-      if (pref == META_PREF_MOUSE_BUTTON_MODS)
+      if (META_PREFS_CHANGED (changes, META_PREF_MOUSE_BUTTON_MODS))
         update_window_grab_modifiers (display);
 
       /* Grab all */
@@ -5726,7 +5845,8 @@ prefs_changed_callback (MetaPreference pref,
 
       g_slist_free (windows);
     }
-  else if (pref == META_PREF_AUDIBLE_BELL)
+
+  if (META_PREFS_CHANGED (changes, META_PREF_AUDIBLE_BELL))
     {
       meta_bell_set_audible (display, meta_prefs_bell_is_audible ());
     }
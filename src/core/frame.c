@@ -382,6 +382,13 @@ meta_frame_get_mask (MetaFrame                    *frame,
                           frame->rect.width, frame->rect.height, cr);
 }
 
+void
+meta_frame_paint (MetaFrame *frame,
+                  cairo_t   *cr)
+{
+  meta_ui_paint_frame (frame->window->screen->ui, frame->xwindow, cr);
+}
+
 void
 meta_frame_queue_draw (MetaFrame *frame)
 {
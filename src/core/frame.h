@@ -73,6 +73,9 @@ cairo_region_t *meta_frame_get_frame_bounds (MetaFrame *frame);
 void meta_frame_get_mask (MetaFrame *frame,
                           cairo_t   *cr);
 
+void meta_frame_paint (MetaFrame *frame,
+                       cairo_t   *cr);
+
 void meta_frame_set_screen_cursor (MetaFrame	*frame,
 				   MetaCursor	cursor);
 
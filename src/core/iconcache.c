@@ -25,6 +25,9 @@
 #include "iconcache.h"
 #include "ui.h"
 #include <meta/errors.h>
+#include <meta/util.h>
+
+#include <string.h>
 
 #include <X11/Xatom.h>
 
@@ -174,36 +177,232 @@ find_best_size (gulong  *data,
     return FALSE;
 }
 
+/* Icons read from _NET_WM_ICON are shared between all windows whose
+ * property carries the same image data; applications with many windows
+ * (terminals, chat clients) usually set the same icon on every one of
+ * them, so we only decode and scale it once.
+ *
+ * The table does not hold a reference on the pixbufs; an entry is
+ * removed again when the last window holding its pixbuf drops it.
+ */
+typedef struct
+{
+  guint      hash;
+  int        src_width;
+  int        src_height;
+  int        width;
+  int        height;
+  guint32   *argb;
+  GdkPixbuf *pixbuf;
+} SharedIcon;
+
+static GHashTable *shared_icons = NULL;
+
+static guint
+shared_icon_hash (gconstpointer key)
+{
+  const SharedIcon *icon = key;
+
+  return icon->hash ^ (icon->width << 16) ^ icon->height;
+}
+
+static gboolean
+shared_icon_equal (gconstpointer a,
+                   gconstpointer b)
+{
+  const SharedIcon *icon_a = a;
+  const SharedIcon *icon_b = b;
+
+  return icon_a->hash == icon_b->hash &&
+    icon_a->src_width == icon_b->src_width &&
+    icon_a->src_height == icon_b->src_height &&
+    icon_a->width == icon_b->width &&
+    icon_a->height == icon_b->height &&
+    memcmp (icon_a->argb, icon_b->argb,
+            icon_a->src_width * icon_a->src_height * sizeof (guint32)) == 0;
+}
+
+static void
+shared_icon_free (gpointer data)
+{
+  SharedIcon *icon = data;
+
+  g_free (icon->argb);
+  g_slice_free (SharedIcon, icon);
+}
+
+static void
+shared_icon_finalized (gpointer  data,
+                       GObject  *where_the_object_was)
+{
+  SharedIcon *icon = data;
+
+  meta_verbose ("Dropping shared %dx%d icon\n", icon->width, icon->height);
+
+  g_hash_table_remove (shared_icons, icon);
+}
+
+/* _NET_WM_ICON comes back from Xlib as an array of longs, which are
+ * 64 bits wide on LP64 even though only the low 32 bits carry data.
+ * Pack it into 32-bit words once so hashing, comparing and converting
+ * all work on the compact copy; the plain loop lets the compiler
+ * vectorize it.
+ */
+static guint32 *
+pack_argb_data (const gulong *argb_data,
+                int           len,
+                guint        *hash)
+{
+  guint32 *packed;
+  guint h;
+  int i;
+
+  packed = g_new (guint32, len);
+
+  for (i = 0; i < len; i++)
+    packed[i] = (guint32) argb_data[i];
+
+  h = 5381;
+  for (i = 0; i < len; i++)
+    h = (h << 5) + h + packed[i];
+
+  *hash = h;
+
+  return packed;
+}
+
 static void
-argbdata_to_pixdata (gulong *argb_data, int len, guchar **pixdata)
+argbdata_to_pixdata (const guint32 *argb_data, int len, guchar **pixdata)
 {
-  guchar *p;
+  guint32 *p;
   int i;
 
   *pixdata = g_new (guchar, len * 4);
-  p = *pixdata;
+  p = (guint32 *) *pixdata;
 
-  /* One could speed this up a lot. */
-  i = 0;
-  while (i < len)
+  /* GdkPixbuf wants R, G, B, A in memory order; swap the R and B
+   * channels of each ARGB word in place instead of going byte by byte.
+   */
+  for (i = 0; i < len; i++)
     {
-      guint argb;
-      guint rgba;
+      guint32 argb = argb_data[i];
 
-      argb = argb_data[i];
-      rgba = (argb << 8) | (argb >> 24);
+      p[i] = GUINT32_TO_LE ((argb & 0xff00ff00) |
+                            ((argb >> 16) & 0xff) |
+                            ((argb & 0xff) << 16));
+    }
+}
 
-      *p = rgba >> 24;
-      ++p;
-      *p = (rgba >> 16) & 0xff;
-      ++p;
-      *p = (rgba >> 8) & 0xff;
-      ++p;
-      *p = rgba & 0xff;
-      ++p;
+static void
+free_pixels (guchar *pixels, gpointer data)
+{
+  g_free (pixels);
+}
 
-      ++i;
+static GdkPixbuf*
+scaled_from_pixdata (guchar *pixdata,
+                     int     w,
+                     int     h,
+                     int     new_w,
+                     int     new_h)
+{
+  GdkPixbuf *src;
+  GdkPixbuf *dest;
+  
+  src = gdk_pixbuf_new_from_data (pixdata,
+                                  GDK_COLORSPACE_RGB,
+                                  TRUE,
+                                  8,
+                                  w, h, w * 4,
+                                  free_pixels, 
+                                  NULL);
+
+  if (src == NULL)
+    return NULL;
+
+  if (w != h)
+    {
+      GdkPixbuf *tmp;
+      int size;
+
+      size = MAX (w, h);
+      
+      tmp = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8, size, size);
+
+      if (tmp)
+	{
+	  gdk_pixbuf_fill (tmp, 0);
+	  gdk_pixbuf_copy_area (src, 0, 0, w, h,
+				tmp,
+				(size - w) / 2, (size - h) / 2);
+	  
+	  g_object_unref (src);
+	  src = tmp;
+	}
+    }
+  
+  if (w != new_w || h != new_h)
+    {
+      dest = gdk_pixbuf_scale_simple (src, new_w, new_h, GDK_INTERP_BILINEAR);
+      
+      g_object_unref (G_OBJECT (src));
+    }
+  else
+    {
+      dest = src;
+    }
+
+  return dest;
+}
+
+static GdkPixbuf*
+shared_icon_from_argb (const gulong *argb_data,
+                       int           w,
+                       int           h,
+                       int           new_w,
+                       int           new_h)
+{
+  SharedIcon key;
+  SharedIcon *icon;
+  guchar *pixdata;
+  GdkPixbuf *pixbuf;
+
+  if (shared_icons == NULL)
+    shared_icons = g_hash_table_new_full (shared_icon_hash,
+                                          shared_icon_equal,
+                                          shared_icon_free,
+                                          NULL);
+
+  key.src_width = w;
+  key.src_height = h;
+  key.width = new_w;
+  key.height = new_h;
+  key.argb = pack_argb_data (argb_data, w * h, &key.hash);
+
+  icon = g_hash_table_lookup (shared_icons, &key);
+  if (icon)
+    {
+      g_free (key.argb);
+      return g_object_ref (icon->pixbuf);
+    }
+
+  argbdata_to_pixdata (key.argb, w * h, &pixdata);
+  pixbuf = scaled_from_pixdata (pixdata, w, h, new_w, new_h);
+
+  if (pixbuf == NULL)
+    {
+      g_free (key.argb);
+      return NULL;
     }
+
+  icon = g_slice_new (SharedIcon);
+  *icon = key;
+  icon->pixbuf = pixbuf;
+
+  g_hash_table_add (shared_icons, icon);
+  g_object_weak_ref (G_OBJECT (pixbuf), shared_icon_finalized, icon);
+
+  return pixbuf;
 }
 
 static gboolean
@@ -213,12 +412,8 @@ read_rgb_icon (MetaDisplay   *display,
                int            ideal_height,
                int            ideal_mini_width,
                int            ideal_mini_height,
-               int           *width,
-               int           *height,
-               guchar       **pixdata,
-               int           *mini_width,
-               int           *mini_height,
-               guchar       **mini_pixdata)
+               GdkPixbuf    **iconp,
+               GdkPixbuf    **mini_iconp)
 {
   Atom type;
   int format;
@@ -271,24 +466,25 @@ read_rgb_icon (MetaDisplay   *display,
       return FALSE;
     }
 
-  *width = w;
-  *height = h;
+  *iconp = shared_icon_from_argb (best, w, h,
+                                  ideal_width, ideal_height);
+  *mini_iconp = shared_icon_from_argb (best_mini, mini_w, mini_h,
+                                       ideal_mini_width, ideal_mini_height);
 
-  *mini_width = mini_w;
-  *mini_height = mini_h;
+  XFree (data);
 
-  argbdata_to_pixdata (best, w * h, pixdata);
-  argbdata_to_pixdata (best_mini, mini_w * mini_h, mini_pixdata);
+  if (*iconp && *mini_iconp)
+    return TRUE;
 
-  XFree (data);
+  if (*iconp)
+    g_object_unref (G_OBJECT (*iconp));
+  if (*mini_iconp)
+    g_object_unref (G_OBJECT (*mini_iconp));
 
-  return TRUE;
-}
+  *iconp = NULL;
+  *mini_iconp = NULL;
 
-static void
-free_pixels (guchar *pixels, gpointer data)
-{
-  g_free (pixels);
+  return FALSE;
 }
 
 static void
@@ -648,62 +844,6 @@ replace_cache (MetaIconCache *icon_cache,
 #endif
 }
 
-static GdkPixbuf*
-scaled_from_pixdata (guchar *pixdata,
-                     int     w,
-                     int     h,
-                     int     new_w,
-                     int     new_h)
-{
-  GdkPixbuf *src;
-  GdkPixbuf *dest;
-  
-  src = gdk_pixbuf_new_from_data (pixdata,
-                                  GDK_COLORSPACE_RGB,
-                                  TRUE,
-                                  8,
-                                  w, h, w * 4,
-                                  free_pixels, 
-                                  NULL);
-
-  if (src == NULL)
-    return NULL;
-
-  if (w != h)
-    {
-      GdkPixbuf *tmp;
-      int size;
-
-      size = MAX (w, h);
-      
-      tmp = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8, size, size);
-
-      if (tmp)
-	{
-	  gdk_pixbuf_fill (tmp, 0);
-	  gdk_pixbuf_copy_area (src, 0, 0, w, h,
-				tmp,
-				(size - w) / 2, (size - h) / 2);
-	  
-	  g_object_unref (src);
-	  src = tmp;
-	}
-    }
-  
-  if (w != new_w || h != new_h)
-    {
-      dest = gdk_pixbuf_scale_simple (src, new_w, new_h, GDK_INTERP_BILINEAR);
-      
-      g_object_unref (G_OBJECT (src));
-    }
-  else
-    {
-      dest = src;
-    }
-
-  return dest;
-}
-
 gboolean
 meta_read_icons (MetaScreen     *screen,
                  Window          xwindow,
@@ -717,10 +857,6 @@ meta_read_icons (MetaScreen     *screen,
                  int             ideal_mini_width,
                  int             ideal_mini_height)
 {
-  guchar *pixdata;
-  int w, h;
-  guchar *mini_pixdata;
-  int mini_w, mini_h;
   Pixmap pixmap;
   Pixmap mask;
 
@@ -747,8 +883,6 @@ meta_read_icons (MetaScreen     *screen,
   if (!meta_icon_cache_get_icon_invalidated (icon_cache))
     return FALSE; /* we have no new info to use */
 
-  pixdata = NULL;
-
   /* Our algorithm here assumes that we can't have for example origin
    * < USING_NET_WM_ICON and icon_cache->net_wm_icon_dirty == FALSE
    * unless we have tried to read NET_WM_ICON.
@@ -767,29 +901,12 @@ meta_read_icons (MetaScreen     *screen,
       if (read_rgb_icon (screen->display, xwindow,
                          ideal_width, ideal_height,
                          ideal_mini_width, ideal_mini_height,
-                         &w, &h, &pixdata,
-                         &mini_w, &mini_h, &mini_pixdata))
+                         iconp, mini_iconp))
         {
-          *iconp = scaled_from_pixdata (pixdata, w, h,
-                                        ideal_width, ideal_height);
+          replace_cache (icon_cache, USING_NET_WM_ICON,
+                         *iconp, *mini_iconp);
 
-          *mini_iconp = scaled_from_pixdata (mini_pixdata, mini_w, mini_h,
-                                             ideal_mini_width, ideal_mini_height);
-
-          if (*iconp && *mini_iconp)
-            {
-              replace_cache (icon_cache, USING_NET_WM_ICON,
-                             *iconp, *mini_iconp);
-              
-              return TRUE;
-            }
-          else
-            {
-              if (*iconp)
-                g_object_unref (G_OBJECT (*iconp));
-              if (*mini_iconp)
-                g_object_unref (G_OBJECT (*mini_iconp));
-            }
+          return TRUE;
         }
     }
 
@@ -50,6 +50,7 @@
 #include <meta/main.h>
 #include <meta/util.h>
 #include "display-private.h"
+#include "util-private.h"
 #include <meta/errors.h>
 #include "ui.h"
 #include "session.h"
@@ -90,8 +91,8 @@ static MetaExitCode meta_exit_code = META_EXIT_SUCCESS;
  */
 static GMainLoop *meta_main_loop = NULL;
 
-static void prefs_changed_callback (MetaPreference pref,
-                                    gpointer       data);
+static void prefs_changed_callback (MetaPrefsChanges changes,
+                                    gpointer         data);
 
 /**
  * log_handler:
@@ -370,6 +371,31 @@ on_sigterm (void)
   return FALSE;
 }
 
+static int sigusr2_pipe_fds[2] = { -1, -1 };
+
+static void
+sigusr2_handler (int signum)
+{
+  int G_GNUC_UNUSED dummy;
+
+  dummy = write (sigusr2_pipe_fds[1], "", 1);
+}
+
+/* SIGUSR2 writes out the trace buffer */
+static gboolean
+on_sigusr2 (GIOChannel  *channel,
+            GIOCondition condition,
+            gpointer     data)
+{
+  char buf[16];
+  int G_GNUC_UNUSED dummy;
+
+  dummy = read (sigusr2_pipe_fds[0], buf, sizeof (buf));
+
+  meta_dump_trace ();
+  return TRUE;
+}
+
 /**
  * meta_init: (skip)
  *
@@ -416,6 +442,29 @@ meta_init (void)
   if (g_getenv ("MUTTER_DEBUG"))
     meta_set_debugging (TRUE);
 
+  if (g_getenv ("MUTTER_TRACE"))
+    {
+      /* Everything goes into the trace buffer, until SIGUSR2 */
+      if (!meta_is_verbose ())
+        meta_add_verbose_topic (META_DEBUG_VERBOSE);
+      meta_set_tracing (TRUE);
+
+      if (pipe (sigusr2_pipe_fds) != 0)
+        g_printerr ("Failed to create SIGUSR2 pipe: %s\n",
+                    g_strerror (errno));
+
+      channel = g_io_channel_unix_new (sigusr2_pipe_fds[0]);
+      g_io_channel_set_flags (channel, G_IO_FLAG_NONBLOCK, NULL);
+      g_io_add_watch (channel, G_IO_IN, on_sigusr2, NULL);
+      g_io_channel_set_close_on_unref (channel, TRUE);
+      g_io_channel_unref (channel);
+
+      act.sa_handler = &sigusr2_handler;
+      if (sigaction (SIGUSR2, &act, NULL) < 0)
+        g_printerr ("Failed to register SIGUSR2 handler: %s\n",
+                    g_strerror (errno));
+    }
+
   if (g_get_home_dir ())
     if (chdir (g_get_home_dir ()) < 0)
       meta_warning ("Could not change to home directory %s.\n",
@@ -504,7 +553,7 @@ meta_run (void)
 
   /* Load prefs */
   meta_prefs_init ();
-  meta_prefs_add_listener (prefs_changed_callback, NULL);
+  meta_prefs_add_changes_listener (prefs_changed_callback, NULL);
 
   for (i=0; i<G_N_ELEMENTS(log_domains); i++)
     g_log_set_handler (log_domains[i],
@@ -582,33 +631,31 @@ meta_quit (MetaExitCode code)
 
 /**
  * prefs_changed_callback:
- * @pref:  Which preference has changed
+ * @changes: Which preferences have changed
  * @data:  Arbitrary data (which we ignore)
  *
  * Called on pref changes. (One of several functions of its kind and purpose.)
+ * The theme and cursor theme are only reloaded once however many of the
+ * preferences they depend on changed together.
  *
  * FIXME: Why are these particular prefs handled in main.c and not others?
  *        Should they be?
  */
 static void
-prefs_changed_callback (MetaPreference pref,
-                        gpointer       data)
+prefs_changed_callback (MetaPrefsChanges changes,
+                        gpointer         data)
 {
-  switch (pref)
+  if (META_PREFS_CHANGED (changes, META_PREF_THEME) ||
+      META_PREFS_CHANGED (changes, META_PREF_DRAGGABLE_BORDER_WIDTH))
     {
-    case META_PREF_THEME:
-    case META_PREF_DRAGGABLE_BORDER_WIDTH:
       meta_ui_set_current_theme (meta_prefs_get_theme ());
       meta_display_retheme_all ();
-      break;
+    }
 
-    case META_PREF_CURSOR_THEME:
-    case META_PREF_CURSOR_SIZE:
+  if (META_PREFS_CHANGED (changes, META_PREF_CURSOR_THEME) ||
+      META_PREFS_CHANGED (changes, META_PREF_CURSOR_SIZE))
+    {
       meta_display_set_cursor_theme (meta_prefs_get_cursor_theme (),
 				     meta_prefs_get_cursor_size ());
-      break;
-    default:
-      /* handled elsewhere or otherwise */
-      break;
     }
 }
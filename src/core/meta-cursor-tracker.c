@@ -45,6 +45,18 @@
 #define META_WAYLAND_DEFAULT_CURSOR_HOTSPOT_X 7
 #define META_WAYLAND_DEFAULT_CURSOR_HOTSPOT_Y 4
 
+/* Applications tend to flip between a handful of cursors, so keep the
+ * sprites of the most recently shown ones
+ */
+#define MAX_CACHED_SPRITES 16
+
+typedef struct {
+  gulong serial;
+  CoglTexture2D *sprite;
+  int hot_x, hot_y;
+  GList link;
+} CachedSprite;
+
 struct _MetaCursorTracker {
   GObject parent_instance;
 
@@ -54,6 +66,10 @@ struct _MetaCursorTracker {
 
   CoglTexture2D *sprite;
   int hot_x, hot_y;
+
+  /* XFixes cursor serial => CachedSprite, most recently used first */
+  GHashTable *sprite_cache;
+  GQueue sprite_lru;
 };
 
 struct _MetaCursorTrackerClass {
@@ -78,6 +94,20 @@ meta_cursor_tracker_init (MetaCursorTracker *self)
    * On wayland we start with the cursor showing
    */
   self->is_showing = TRUE;
+
+  self->sprite_cache = g_hash_table_new (NULL, NULL);
+  g_queue_init (&self->sprite_lru);
+}
+
+static void
+cached_sprite_remove (MetaCursorTracker *self,
+                      CachedSprite      *cached)
+{
+  g_hash_table_remove (self->sprite_cache, GSIZE_TO_POINTER (cached->serial));
+  g_queue_unlink (&self->sprite_lru, &cached->link);
+
+  cogl_object_unref (cached->sprite);
+  g_slice_free (CachedSprite, cached);
 }
 
 static void
@@ -88,6 +118,10 @@ meta_cursor_tracker_finalize (GObject *object)
   if (self->sprite)
     cogl_object_unref (self->sprite);
 
+  while (self->sprite_lru.head)
+    cached_sprite_remove (self, self->sprite_lru.head->data);
+  g_hash_table_destroy (self->sprite_cache);
+
   G_OBJECT_CLASS (meta_cursor_tracker_parent_class)->finalize (object);
 }
 
@@ -146,6 +180,7 @@ meta_cursor_tracker_handle_xevent (MetaCursorTracker *tracker,
                                    XEvent            *xevent)
 {
   XFixesCursorNotifyEvent *notify_event;
+  CachedSprite *cached;
 
   if (xevent->xany.type != tracker->screen->display->xfixes_event_base + XFixesCursorNotify)
     return FALSE;
@@ -155,6 +190,22 @@ meta_cursor_tracker_handle_xevent (MetaCursorTracker *tracker,
     return FALSE;
 
   g_clear_pointer (&tracker->sprite, cogl_object_unref);
+
+  /* The serial identifies the cursor, so if we have seen it before we
+   * don't need to fetch its image again
+   */
+  cached = g_hash_table_lookup (tracker->sprite_cache,
+                                GSIZE_TO_POINTER (notify_event->cursor_serial));
+  if (cached)
+    {
+      tracker->sprite = cogl_object_ref (cached->sprite);
+      tracker->hot_x = cached->hot_x;
+      tracker->hot_y = cached->hot_y;
+
+      g_queue_unlink (&tracker->sprite_lru, &cached->link);
+      g_queue_push_head_link (&tracker->sprite_lru, &cached->link);
+    }
+
   g_signal_emit (tracker, signals[CURSOR_CHANGED], 0);
 
   return TRUE;
@@ -165,6 +216,7 @@ ensure_xfixes_cursor (MetaCursorTracker *tracker)
 {
   XFixesCursorImage *cursor_image;
   CoglTexture2D *sprite;
+  CachedSprite *cached;
   guint8 *cursor_data;
   gboolean free_cursor_data;
   CoglContext *ctx;
@@ -185,19 +237,19 @@ ensure_xfixes_cursor (MetaCursorTracker *tracker)
     }
   else
     {
-      int i, j;
+      int i, n_pixels;
       guint32 *cursor_words;
-      gulong *p;
-      guint32 *q;
+      const gulong *p;
 
-      cursor_words = g_new (guint32, cursor_image->width * cursor_image->height);
+      n_pixels = cursor_image->width * cursor_image->height;
+      cursor_words = g_new (guint32, n_pixels);
       cursor_data = (guint8 *)cursor_words;
 
+      /* A plain indexed loop, so that the compiler can vectorize the
+       * narrowing */
       p = cursor_image->pixels;
-      q = cursor_words;
-      for (j = 0; j < cursor_image->height; j++)
-        for (i = 0; i < cursor_image->width; i++)
-          *(q++) = *(p++);
+      for (i = 0; i < n_pixels; i++)
+        cursor_words[i] = (guint32) p[i];
 
       free_cursor_data = TRUE;
     }
@@ -220,6 +272,26 @@ ensure_xfixes_cursor (MetaCursorTracker *tracker)
       tracker->sprite = sprite;
       tracker->hot_x = cursor_image->xhot;
       tracker->hot_y = cursor_image->yhot;
+
+      cached = g_hash_table_lookup (tracker->sprite_cache,
+                                    GSIZE_TO_POINTER (cursor_image->cursor_serial));
+      if (cached)
+        cached_sprite_remove (tracker, cached);
+
+      cached = g_slice_new (CachedSprite);
+      cached->serial = cursor_image->cursor_serial;
+      cached->sprite = cogl_object_ref (sprite);
+      cached->hot_x = cursor_image->xhot;
+      cached->hot_y = cursor_image->yhot;
+      cached->link.data = cached;
+      cached->link.prev = cached->link.next = NULL;
+
+      g_hash_table_insert (tracker->sprite_cache,
+                           GSIZE_TO_POINTER (cached->serial), cached);
+      g_queue_push_head_link (&tracker->sprite_lru, &cached->link);
+
+      if (tracker->sprite_lru.length > MAX_CACHED_SPRITES)
+        cached_sprite_remove (tracker, tracker->sprite_lru.tail->data);
     }
   XFree (cursor_image);
 }
@@ -22,9 +22,26 @@
  *         from gnome-desktop/libgnome-desktop/gnome-idle-monitor.c
  */
 
+#include <gio/gio.h>
 #include <meta/meta-idle-monitor.h>
 
 void meta_idle_monitor_handle_xevent_all (XEvent *xevent);
 
 
 void meta_idle_monitor_init_dbus (void);
+
+/* Delivery of WatchFired signals to one D-Bus client */
+typedef struct _MetaIdleMonitorDBusClient MetaIdleMonitorDBusClient;
+
+MetaIdleMonitorDBusClient *meta_idle_monitor_dbus_client_new   (GDBusConnection *connection,
+                                                                const char      *dbus_name,
+                                                                const char      *object_path);
+void                       meta_idle_monitor_dbus_client_unref (MetaIdleMonitorDBusClient *client);
+
+void meta_idle_monitor_dbus_client_set_batched              (MetaIdleMonitorDBusClient *client,
+                                                             gboolean                   batched);
+void meta_idle_monitor_dbus_client_set_user_active_interval (MetaIdleMonitorDBusClient *client,
+                                                             guint                      interval_msec);
+void meta_idle_monitor_dbus_client_watch_fired              (MetaIdleMonitorDBusClient *client,
+                                                             guint                      watch_id,
+                                                             gboolean                   is_user_active);
@@ -49,14 +49,27 @@ struct _MetaIdleMonitor
   GObject parent_instance;
 
   GHashTable  *watches;
-  GHashTable  *alarms;
+  /* All watches, sorted by timeout, user active ones first */
+  GSequence   *sorted_watches;
   int          device_id;
 
+  /* How much of the current idle period was already dispatched:
+     idle watches with a timeout up to this have fired, or were
+     added late and got their own idle callback */
+  guint64      dispatched_msec;
+
   /* X11 implementation */
   Display     *display;
   int          sync_event_base;
   XSyncCounter counter;
   XSyncAlarm   user_active_alarm;
+  gboolean     user_active_alarm_enabled;
+  /* Shared by all idle watches, set for the next timeout. It is a
+     comparison rather than a transition, so that moving it to a
+     timeout the idle time has already passed makes it go off right
+     away instead of never; 0 if it is off */
+  XSyncAlarm   idle_alarm;
+  guint64      idle_alarm_msec;
 };
 
 struct _MetaIdleMonitorClass
@@ -72,9 +85,8 @@ typedef struct
   gpointer		    user_data;
   GDestroyNotify            notify;
   guint64                   timeout_msec;
+  GSequenceIter            *iter;
 
-  /* x11 */
-  XSyncAlarm                xalarm;
   int                       idle_source_id;
 } MetaIdleMonitorWatch;
 
@@ -154,38 +166,197 @@ _xsync_alarm_set (MetaIdleMonitor	*monitor,
 }
 
 static void
-ensure_alarm_rescheduled (Display    *dpy,
-			  XSyncAlarm  alarm)
+set_alarm_enabled (Display    *dpy,
+		   XSyncAlarm  alarm,
+		   gboolean    enabled)
 {
   XSyncAlarmAttributes attr;
+  attr.events = enabled;
+  XSyncChangeAlarm (dpy, alarm, XSyncCAEvents, &attr);
+}
+
+static int
+compare_watches (gconstpointer a,
+                 gconstpointer b,
+                 gpointer      user_data)
+{
+  const MetaIdleMonitorWatch *watch_a = a;
+  const MetaIdleMonitorWatch *watch_b = b;
+
+  if (watch_a->timeout_msec != watch_b->timeout_msec)
+    return watch_a->timeout_msec < watch_b->timeout_msec ? -1 : 1;
+
+  if (watch_a->id != watch_b->id)
+    return watch_a->id < watch_b->id ? -1 : 1;
+
+  return 0;
+}
+
+/* Returns the first watch with a timeout above msec, in O(log n) */
+static GSequenceIter *
+find_watch_after (MetaIdleMonitor *monitor,
+                  guint64          msec)
+{
+  MetaIdleMonitorWatch probe;
+
+  probe.timeout_msec = msec;
+  probe.id = G_MAXUINT;
 
-  /* Some versions of Xorg have an issue where alarms aren't
-   * always rescheduled. Calling XSyncChangeAlarm, even
-   * without any attributes, will reschedule the alarm. */
-  XSyncChangeAlarm (dpy, alarm, 0, &attr);
+  return g_sequence_search (monitor->sorted_watches, &probe,
+                            compare_watches, NULL);
 }
 
+/* Points the idle alarm at the first timeout that wasn't
+ * dispatched yet in this idle period, or turns it off.
+ */
 static void
-set_alarm_enabled (Display    *dpy,
-		   XSyncAlarm  alarm,
-		   gboolean    enabled)
+update_idle_alarm (MetaIdleMonitor *monitor)
 {
   XSyncAlarmAttributes attr;
-  attr.events = enabled;
-  XSyncChangeAlarm (dpy, alarm, XSyncCAEvents, &attr);
+  GSequenceIter *iter;
+  guint64 next_msec;
+
+  if (monitor->idle_alarm == None)
+    return;
+
+  iter = find_watch_after (monitor, monitor->dispatched_msec);
+  if (g_sequence_iter_is_end (iter))
+    next_msec = 0;
+  else
+    next_msec = ((MetaIdleMonitorWatch *) g_sequence_get (iter))->timeout_msec;
+
+  if (next_msec == monitor->idle_alarm_msec)
+    return;
+
+  monitor->idle_alarm_msec = next_msec;
+
+  if (next_msec == 0)
+    {
+      set_alarm_enabled (monitor->display, monitor->idle_alarm, FALSE);
+      return;
+    }
+
+  attr.events = TRUE;
+  GUINT64_TO_XSYNCVALUE (next_msec, &attr.trigger.wait_value);
+  XSyncChangeAlarm (monitor->display, monitor->idle_alarm,
+                    XSyncCAValue | XSyncCAEvents, &attr);
 }
 
+/* We need to hear about the user becoming active if somebody
+ * asked for it, or to start a new idle period for the idle alarm.
+ */
 static void
-check_x11_watch (gpointer data,
-                 gpointer user_data)
+update_user_active_alarm (MetaIdleMonitor *monitor)
 {
-  MetaIdleMonitorWatch *watch = data;
-  XSyncAlarm alarm = (XSyncAlarm) user_data;
+  GSequenceIter *begin;
+  gboolean enabled;
 
-  if (watch->xalarm != alarm)
+  if (monitor->user_active_alarm == None)
     return;
 
-  fire_watch (watch);
+  begin = g_sequence_get_begin_iter (monitor->sorted_watches);
+  enabled = (monitor->dispatched_msec > 0 ||
+             (!g_sequence_iter_is_end (begin) &&
+              ((MetaIdleMonitorWatch *) g_sequence_get (begin))->timeout_msec == 0));
+
+  if (enabled == monitor->user_active_alarm_enabled)
+    return;
+
+  monitor->user_active_alarm_enabled = enabled;
+  set_alarm_enabled (monitor->display, monitor->user_active_alarm, enabled);
+}
+
+/* Fires the watches collected in ids, looking each one up again
+ * since a callback may remove other watches
+ */
+static void
+fire_watches (MetaIdleMonitor *monitor,
+              GArray          *ids)
+{
+  guint i;
+
+  g_object_ref (monitor);
+
+  for (i = 0; i < ids->len; i++)
+    {
+      MetaIdleMonitorWatch *watch;
+
+      watch = g_hash_table_lookup (monitor->watches,
+                                   GUINT_TO_POINTER (g_array_index (ids, guint, i)));
+      if (watch)
+        fire_watch (watch);
+    }
+
+  g_object_unref (monitor);
+}
+
+static void
+handle_idle_alarm (MetaIdleMonitor *monitor)
+{
+  GSequenceIter *iter;
+  GArray *ids;
+  gint64 idletime;
+
+  idletime = meta_idle_monitor_get_idletime (monitor);
+  if (idletime < 0)
+    return;
+
+  /* Everything between the last dispatch and now, which also
+     catches up with timeouts we went past while the event was
+     in flight */
+  ids = g_array_new (FALSE, FALSE, sizeof (guint));
+
+  for (iter = find_watch_after (monitor, monitor->dispatched_msec);
+       !g_sequence_iter_is_end (iter);
+       iter = g_sequence_iter_next (iter))
+    {
+      MetaIdleMonitorWatch *watch = g_sequence_get (iter);
+
+      if (watch->timeout_msec > (guint64) idletime)
+        break;
+
+      g_array_append_val (ids, watch->id);
+    }
+
+  monitor->dispatched_msec = MAX (monitor->dispatched_msec, (guint64) idletime);
+
+  update_idle_alarm (monitor);
+  update_user_active_alarm (monitor);
+
+  fire_watches (monitor, ids);
+  g_array_free (ids, TRUE);
+}
+
+static void
+handle_user_active_alarm (MetaIdleMonitor *monitor)
+{
+  GSequenceIter *iter;
+  GArray *ids;
+
+  ids = g_array_new (FALSE, FALSE, sizeof (guint));
+
+  for (iter = g_sequence_get_begin_iter (monitor->sorted_watches);
+       !g_sequence_iter_is_end (iter);
+       iter = g_sequence_iter_next (iter))
+    {
+      MetaIdleMonitorWatch *watch = g_sequence_get (iter);
+
+      if (watch->timeout_msec != 0)
+        break;
+
+      g_array_append_val (ids, watch->id);
+    }
+
+  /* A new idle period starts */
+  monitor->dispatched_msec = 0;
+  update_idle_alarm (monitor);
+
+  /* Firing removes the user active watches, and turns the alarm off
+     if nothing else needs it */
+  fire_watches (monitor, ids);
+  g_array_free (ids, TRUE);
+
+  update_user_active_alarm (monitor);
 }
 
 static void
@@ -193,36 +364,28 @@ meta_idle_monitor_handle_xevent (MetaIdleMonitor       *monitor,
                                  XSyncAlarmNotifyEvent *alarm_event)
 {
   XSyncAlarm alarm;
-  GList *watches;
-  gboolean has_alarm;
 
   if (alarm_event->state != XSyncAlarmActive)
     return;
 
   alarm = alarm_event->alarm;
 
-  has_alarm = FALSE;
-
   if (alarm == monitor->user_active_alarm)
     {
-      set_alarm_enabled (monitor->display,
-                         alarm,
-                         FALSE);
-      has_alarm = TRUE;
-    }
-  else if (g_hash_table_contains (monitor->alarms, (gpointer) alarm))
-    {
-      ensure_alarm_rescheduled (monitor->display,
-                                alarm);
-      has_alarm = TRUE;
-    }
+      /* The alarm is off from now on, as far as the server goes */
+      set_alarm_enabled (monitor->display, alarm, FALSE);
+      monitor->user_active_alarm_enabled = FALSE;
 
-  if (has_alarm)
+      handle_user_active_alarm (monitor);
+    }
+  else if (alarm == monitor->idle_alarm)
     {
-      watches = g_hash_table_get_values (monitor->watches);
+      /* With a delta of 0, a comparison alarm goes inactive once it
+         has fired; handle_idle_alarm() moves it on to the next
+         timeout, which also makes it active again */
+      monitor->idle_alarm_msec = 0;
 
-      g_list_foreach (watches, check_x11_watch, (gpointer) alarm);
-      g_list_free (watches);
+      handle_idle_alarm (monitor);
     }
 }
 
@@ -298,12 +461,10 @@ idle_monitor_watch_free (MetaIdleMonitorWatch *watch)
   if (watch->notify != NULL)
     watch->notify (watch->user_data);
 
-  if (watch->xalarm != monitor->user_active_alarm &&
-      watch->xalarm != None)
-    {
-      XSyncDestroyAlarm (monitor->display, watch->xalarm);
-      g_hash_table_remove (monitor->alarms, (gpointer) watch->xalarm);
-    }
+  g_sequence_remove (watch->iter);
+
+  /* The alarms stay where they are; if they go off for nothing,
+     they are moved then */
 
   g_object_unref (monitor);
   g_slice_free (MetaIdleMonitorWatch, watch);
@@ -321,6 +482,7 @@ init_xsync (MetaIdleMonitor *monitor)
     }
 
   monitor->user_active_alarm = _xsync_alarm_set (monitor, XSyncNegativeTransition, 1, FALSE);
+  monitor->idle_alarm = _xsync_alarm_set (monitor, XSyncPositiveComparison, G_MAXINT32, FALSE);
 }
 
 static void
@@ -330,8 +492,9 @@ meta_idle_monitor_dispose (GObject *object)
 
   monitor = META_IDLE_MONITOR (object);
 
+  /* Watches remove themselves from sorted_watches */
   g_clear_pointer (&monitor->watches, g_hash_table_destroy);
-  g_clear_pointer (&monitor->alarms, g_hash_table_destroy);
+  g_clear_pointer (&monitor->sorted_watches, g_sequence_free);
 
   if (monitor->user_active_alarm != None)
     {
@@ -339,6 +502,12 @@ meta_idle_monitor_dispose (GObject *object)
       monitor->user_active_alarm = None;
     }
 
+  if (monitor->idle_alarm != None)
+    {
+      XSyncDestroyAlarm (monitor->display, monitor->idle_alarm);
+      monitor->idle_alarm = None;
+    }
+
   G_OBJECT_CLASS (meta_idle_monitor_parent_class)->dispose (object);
 }
 
@@ -420,7 +589,7 @@ meta_idle_monitor_init (MetaIdleMonitor *monitor)
                                                   NULL,
                                                   (GDestroyNotify)idle_monitor_watch_free);
 
-  monitor->alarms = g_hash_table_new (NULL, NULL);
+  monitor->sorted_watches = g_sequence_new (NULL);
 }
 
 static void
@@ -491,22 +660,21 @@ make_watch (MetaIdleMonitor           *monitor,
   watch->user_data = user_data;
   watch->notify = notify;
   watch->timeout_msec = timeout_msec;
+  watch->iter = g_sequence_insert_sorted (monitor->sorted_watches, watch,
+                                          compare_watches, NULL);
 
-  if (timeout_msec != 0)
+  if (timeout_msec != 0 && timeout_msec <= monitor->dispatched_msec)
     {
-      watch->xalarm = _xsync_alarm_set (monitor, XSyncPositiveTransition, timeout_msec, TRUE);
-
-      g_hash_table_add (monitor->alarms, (gpointer) watch->xalarm);
-
-      if (meta_idle_monitor_get_idletime (monitor) > (gint64)timeout_msec)
-        watch->idle_source_id = g_idle_add (fire_watch_idle, watch);
+      /* We are past it in this idle period already */
+      watch->idle_source_id = g_idle_add (fire_watch_idle, watch);
     }
-  else if (monitor->user_active_alarm != None)
-    {
-      watch->xalarm = monitor->user_active_alarm;
 
-      set_alarm_enabled (monitor->display, monitor->user_active_alarm, TRUE);
-    }
+  /* Otherwise the idle alarm gets to it; if it becomes the next
+     timeout and the idle time is past it already, the alarm goes
+     off as soon as it is moved there */
+
+  update_idle_alarm (monitor);
+  update_user_active_alarm (monitor);
 
   g_hash_table_insert (monitor->watches,
                        GUINT_TO_POINTER (watch->id),
@@ -641,23 +809,224 @@ handle_get_idletime (MetaDBusIdleMonitor   *skeleton,
   return TRUE;
 }
 
-typedef struct {
-  MetaDBusIdleMonitor *dbus_monitor;
-  MetaIdleMonitor *monitor;
+/* What we know about one D-Bus client of one monitor object */
+struct _MetaIdleMonitorDBusClient
+{
+  guint ref_count;
+
+  GDBusConnection *connection;
   char *dbus_name;
-  guint watch_id;
+  char *object_path;
   guint name_watcher_id;
+
+  /* Weak, and NULL when not created for a monitor */
+  MetaIdleMonitor *monitor;
+  GHashTable *watch_ids;
+
+  gboolean batched;
+  GArray *pending;
+  guint pending_id;
+
+  guint user_active_interval;
+  gint64 last_user_active_time;
+  GArray *pending_user_active;
+  guint pending_user_active_id;
+};
+
+typedef struct {
+  MetaIdleMonitorDBusClient *client;
+  guint watch_id;
+  gboolean is_user_active;
 } DBusWatch;
 
+MetaIdleMonitorDBusClient *
+meta_idle_monitor_dbus_client_new (GDBusConnection *connection,
+                                   const char      *dbus_name,
+                                   const char      *object_path)
+{
+  MetaIdleMonitorDBusClient *client;
+
+  client = g_slice_new0 (MetaIdleMonitorDBusClient);
+  client->ref_count = 1;
+  client->connection = g_object_ref (connection);
+  client->dbus_name = g_strdup (dbus_name);
+  client->object_path = g_strdup (object_path);
+  client->watch_ids = g_hash_table_new (NULL, NULL);
+  client->pending = g_array_new (FALSE, FALSE, sizeof (guint));
+  client->pending_user_active = g_array_new (FALSE, FALSE, sizeof (guint));
+
+  return client;
+}
+
+static MetaIdleMonitorDBusClient *
+meta_idle_monitor_dbus_client_ref (MetaIdleMonitorDBusClient *client)
+{
+  client->ref_count++;
+  return client;
+}
+
+void
+meta_idle_monitor_dbus_client_unref (MetaIdleMonitorDBusClient *client)
+{
+  if (--client->ref_count > 0)
+    return;
+
+  if (client->pending_id)
+    g_source_remove (client->pending_id);
+  if (client->pending_user_active_id)
+    g_source_remove (client->pending_user_active_id);
+  if (client->name_watcher_id)
+    g_bus_unwatch_name (client->name_watcher_id);
+  if (client->monitor)
+    g_object_remove_weak_pointer (G_OBJECT (client->monitor),
+                                  (gpointer *) &client->monitor);
+
+  g_array_free (client->pending, TRUE);
+  g_array_free (client->pending_user_active, TRUE);
+  g_hash_table_destroy (client->watch_ids);
+  g_object_unref (client->connection);
+  g_free (client->dbus_name);
+  g_free (client->object_path);
+
+  g_slice_free (MetaIdleMonitorDBusClient, client);
+}
+
+/* When batched, all the watches of the client that fire in one main
+ * loop iteration are reported together by a single WatchesFired
+ * signal, instead of one WatchFired signal each.
+ */
+void
+meta_idle_monitor_dbus_client_set_batched (MetaIdleMonitorDBusClient *client,
+                                           gboolean                   batched)
+{
+  client->batched = batched;
+}
+
+/* Reports user active watches of the client at most once every
+ * interval_msec milliseconds, holding back and merging whatever
+ * fires in between. 0 reports them right away.
+ */
+void
+meta_idle_monitor_dbus_client_set_user_active_interval (MetaIdleMonitorDBusClient *client,
+                                                        guint                      interval_msec)
+{
+  client->user_active_interval = interval_msec;
+}
+
+static void
+emit_watches_fired (MetaIdleMonitorDBusClient *client,
+                    GArray                    *ids)
+{
+  guint i;
+
+  if (ids->len == 0)
+    return;
+
+  if (client->batched)
+    {
+      g_dbus_connection_emit_signal (client->connection,
+                                     client->dbus_name,
+                                     client->object_path,
+                                     "org.gnome.Mutter.IdleMonitor",
+                                     "WatchesFired",
+                                     g_variant_new ("(@au)",
+                                                    g_variant_new_fixed_array (G_VARIANT_TYPE_UINT32,
+                                                                               ids->data, ids->len,
+                                                                               sizeof (guint))),
+                                     NULL);
+    }
+  else
+    {
+      for (i = 0; i < ids->len; i++)
+        g_dbus_connection_emit_signal (client->connection,
+                                       client->dbus_name,
+                                       client->object_path,
+                                       "org.gnome.Mutter.IdleMonitor",
+                                       "WatchFired",
+                                       g_variant_new ("(u)", g_array_index (ids, guint, i)),
+                                       NULL);
+    }
+
+  g_array_set_size (ids, 0);
+}
+
+static gboolean
+flush_pending (gpointer data)
+{
+  MetaIdleMonitorDBusClient *client = data;
+
+  client->pending_id = 0;
+  emit_watches_fired (client, client->pending);
+
+  return FALSE;
+}
+
+static gboolean
+flush_pending_user_active (gpointer data)
+{
+  MetaIdleMonitorDBusClient *client = data;
+
+  client->pending_user_active_id = 0;
+  client->last_user_active_time = g_get_monotonic_time ();
+  emit_watches_fired (client, client->pending_user_active);
+
+  return FALSE;
+}
+
+/* Tells the client that its watch fired, right away or later
+ * depending on its settings.
+ */
+void
+meta_idle_monitor_dbus_client_watch_fired (MetaIdleMonitorDBusClient *client,
+                                           guint                      watch_id,
+                                           gboolean                   is_user_active)
+{
+  if (is_user_active && client->user_active_interval > 0)
+    {
+      gint64 now, next;
+
+      now = g_get_monotonic_time ();
+      next = client->last_user_active_time + (gint64) client->user_active_interval * 1000;
+
+      if (client->pending_user_active_id != 0 || now < next)
+        {
+          g_array_append_val (client->pending_user_active, watch_id);
+
+          if (client->pending_user_active_id == 0)
+            client->pending_user_active_id = g_timeout_add ((next - now + 999) / 1000,
+                                                            flush_pending_user_active,
+                                                            client);
+          return;
+        }
+
+      client->last_user_active_time = now;
+    }
+
+  if (!client->batched)
+    {
+      g_dbus_connection_emit_signal (client->connection,
+                                     client->dbus_name,
+                                     client->object_path,
+                                     "org.gnome.Mutter.IdleMonitor",
+                                     "WatchFired",
+                                     g_variant_new ("(u)", watch_id),
+                                     NULL);
+      return;
+    }
+
+  g_array_append_val (client->pending, watch_id);
+
+  if (client->pending_id == 0)
+    client->pending_id = g_idle_add (flush_pending, client);
+}
+
 static void
 destroy_dbus_watch (gpointer data)
 {
   DBusWatch *watch = data;
 
-  g_object_unref (watch->dbus_monitor);
-  g_object_unref (watch->monitor);
-  g_free (watch->dbus_name);
-  g_bus_unwatch_name (watch->name_watcher_id);
+  g_hash_table_remove (watch->client->watch_ids, GUINT_TO_POINTER (watch->watch_id));
+  meta_idle_monitor_dbus_client_unref (watch->client);
 
   g_slice_free (DBusWatch, watch);
 }
@@ -668,15 +1037,16 @@ dbus_idle_callback (MetaIdleMonitor *monitor,
                     gpointer         user_data)
 {
   DBusWatch *watch = user_data;
-  GDBusInterfaceSkeleton *skeleton = G_DBUS_INTERFACE_SKELETON (watch->dbus_monitor);
 
-  g_dbus_connection_emit_signal (g_dbus_interface_skeleton_get_connection (skeleton),
-                                 watch->dbus_name,
-                                 g_dbus_interface_skeleton_get_object_path (skeleton),
-                                 "org.gnome.Mutter.IdleMonitor",
-                                 "WatchFired",
-                                 g_variant_new ("(u)", watch_id),
-                                 NULL);
+  meta_idle_monitor_dbus_client_watch_fired (watch->client, watch_id,
+                                             watch->is_user_active);
+}
+
+static char *
+dbus_client_key (const char *dbus_name,
+                 const char *object_path)
+{
+  return g_strconcat (dbus_name, " ", object_path, NULL);
 }
 
 static void
@@ -684,28 +1054,91 @@ name_vanished_callback (GDBusConnection *connection,
                         const char      *name,
                         gpointer         user_data)
 {
-  DBusWatch *watch = user_data;
+  MetaIdleMonitorDBusClient *client = user_data;
+  GHashTable *clients;
+  GList *ids, *l;
+  char *key;
+
+  if (client->monitor == NULL)
+    return;
+
+  meta_idle_monitor_dbus_client_ref (client);
+
+  ids = g_hash_table_get_keys (client->watch_ids);
+  for (l = ids; l; l = l->next)
+    meta_idle_monitor_remove_watch (client->monitor, GPOINTER_TO_UINT (l->data));
+  g_list_free (ids);
+
+  clients = g_object_get_data (G_OBJECT (client->monitor), "meta-dbus-clients");
+  key = dbus_client_key (client->dbus_name, client->object_path);
+  g_hash_table_remove (clients, key);
+  g_free (key);
+
+  meta_idle_monitor_dbus_client_unref (client);
+}
+
+/* Clients are kept per sender and object path, on the monitor, so
+ * that their settings apply to all their watches, and a single name
+ * watch cleans them all up.
+ */
+static MetaIdleMonitorDBusClient *
+get_dbus_client (MetaDBusIdleMonitor   *skeleton,
+                 GDBusMethodInvocation *invocation,
+                 MetaIdleMonitor       *monitor)
+{
+  MetaIdleMonitorDBusClient *client;
+  GHashTable *clients;
+  const char *sender, *object_path;
+  char *key;
+
+  clients = g_object_get_data (G_OBJECT (monitor), "meta-dbus-clients");
+  if (clients == NULL)
+    {
+      clients = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                       (GDestroyNotify) meta_idle_monitor_dbus_client_unref);
+      g_object_set_data_full (G_OBJECT (monitor), "meta-dbus-clients",
+                              clients, (GDestroyNotify) g_hash_table_destroy);
+    }
+
+  sender = g_dbus_method_invocation_get_sender (invocation);
+  object_path = g_dbus_interface_skeleton_get_object_path (G_DBUS_INTERFACE_SKELETON (skeleton));
+  key = dbus_client_key (sender, object_path);
+
+  client = g_hash_table_lookup (clients, key);
+  if (client)
+    {
+      g_free (key);
+      return client;
+    }
+
+  client = meta_idle_monitor_dbus_client_new (g_dbus_method_invocation_get_connection (invocation),
+                                              sender, object_path);
+  client->monitor = monitor;
+  g_object_add_weak_pointer (G_OBJECT (monitor), (gpointer *) &client->monitor);
+
+  g_hash_table_insert (clients, key, client);
+
+  client->name_watcher_id = g_bus_watch_name_on_connection (client->connection,
+                                                            sender,
+                                                            G_BUS_NAME_WATCHER_FLAGS_NONE,
+                                                            NULL, /* appeared */
+                                                            name_vanished_callback,
+                                                            client, NULL);
 
-  meta_idle_monitor_remove_watch (watch->monitor, watch->watch_id);
+  return client;
 }
 
 static DBusWatch *
 make_dbus_watch (MetaDBusIdleMonitor   *skeleton,
                  GDBusMethodInvocation *invocation,
-                 MetaIdleMonitor       *monitor)
+                 MetaIdleMonitor       *monitor,
+                 gboolean               is_user_active)
 {
   DBusWatch *watch;
 
   watch = g_slice_new (DBusWatch);
-  watch->dbus_monitor = g_object_ref (skeleton);
-  watch->monitor = g_object_ref (monitor);
-  watch->dbus_name = g_strdup (g_dbus_method_invocation_get_sender (invocation));
-  watch->name_watcher_id = g_bus_watch_name_on_connection (g_dbus_method_invocation_get_connection (invocation),
-                                                           watch->dbus_name,
-                                                           G_BUS_NAME_WATCHER_FLAGS_NONE,
-                                                           NULL, /* appeared */
-                                                           name_vanished_callback,
-                                                           watch, NULL);
+  watch->client = meta_idle_monitor_dbus_client_ref (get_dbus_client (skeleton, invocation, monitor));
+  watch->is_user_active = is_user_active;
 
   return watch;
 }
@@ -718,9 +1151,10 @@ handle_add_idle_watch (MetaDBusIdleMonitor   *skeleton,
 {
   DBusWatch *watch;
 
-  watch = make_dbus_watch (skeleton, invocation, monitor);
+  watch = make_dbus_watch (skeleton, invocation, monitor, FALSE);
   watch->watch_id = meta_idle_monitor_add_idle_watch (monitor, interval,
                                                       dbus_idle_callback, watch, destroy_dbus_watch);
+  g_hash_table_add (watch->client->watch_ids, GUINT_TO_POINTER (watch->watch_id));
 
   meta_dbus_idle_monitor_complete_add_idle_watch (skeleton, invocation, watch->watch_id);
 
@@ -734,16 +1168,43 @@ handle_add_user_active_watch (MetaDBusIdleMonitor   *skeleton,
 {
   DBusWatch *watch;
 
-  watch = make_dbus_watch (skeleton, invocation, monitor);
+  watch = make_dbus_watch (skeleton, invocation, monitor, TRUE);
   watch->watch_id = meta_idle_monitor_add_user_active_watch (monitor,
                                                              dbus_idle_callback, watch,
                                                              destroy_dbus_watch);
+  g_hash_table_add (watch->client->watch_ids, GUINT_TO_POINTER (watch->watch_id));
 
   meta_dbus_idle_monitor_complete_add_user_active_watch (skeleton, invocation, watch->watch_id);
 
   return TRUE;
 }
 
+static gboolean
+handle_set_batched (MetaDBusIdleMonitor   *skeleton,
+                    GDBusMethodInvocation *invocation,
+                    gboolean               batched,
+                    MetaIdleMonitor       *monitor)
+{
+  meta_idle_monitor_dbus_client_set_batched (get_dbus_client (skeleton, invocation, monitor),
+                                             batched);
+  meta_dbus_idle_monitor_complete_set_batched (skeleton, invocation);
+
+  return TRUE;
+}
+
+static gboolean
+handle_set_user_active_rate_limit (MetaDBusIdleMonitor   *skeleton,
+                                   GDBusMethodInvocation *invocation,
+                                   guint                  interval,
+                                   MetaIdleMonitor       *monitor)
+{
+  meta_idle_monitor_dbus_client_set_user_active_interval (get_dbus_client (skeleton, invocation, monitor),
+                                                          interval);
+  meta_dbus_idle_monitor_complete_set_user_active_rate_limit (skeleton, invocation);
+
+  return TRUE;
+}
+
 static gboolean
 handle_remove_watch (MetaDBusIdleMonitor   *skeleton,
                      GDBusMethodInvocation *invocation,
@@ -773,6 +1234,10 @@ create_monitor_skeleton (GDBusObjectManagerServer *manager,
                            G_CALLBACK (handle_remove_watch), monitor, 0);
   g_signal_connect_object (skeleton, "handle-get-idletime",
                            G_CALLBACK (handle_get_idletime), monitor, 0);
+  g_signal_connect_object (skeleton, "handle-set-batched",
+                           G_CALLBACK (handle_set_batched), monitor, 0);
+  g_signal_connect_object (skeleton, "handle-set-user-active-rate-limit",
+                           G_CALLBACK (handle_set_user_active_rate_limit), monitor, 0);
 
   object = meta_dbus_object_skeleton_new (path);
   meta_dbus_object_skeleton_set_idle_monitor (object, skeleton);
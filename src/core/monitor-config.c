@@ -86,6 +86,9 @@ struct _MetaMonitorConfig {
 
   GFile *file;
   GCancellable *save_cancellable;
+  guint save_id;
+  gboolean save_pending;
+  char *saved_contents;
 
   UpClient *up_client;
   gboolean lid_is_closed;
@@ -159,6 +162,53 @@ output_config_equal (const MetaOutputConfig *one,
   return memcmp (one, two, sizeof (MetaOutputConfig)) == 0;
 }
 
+static int
+compare_output_keys (gconstpointer one,
+                     gconstpointer two,
+                     gpointer      user_data)
+{
+  const MetaConfiguration *config = user_data;
+
+  return strcmp (config->keys[*(const unsigned int *) one].connector,
+                 config->keys[*(const unsigned int *) two].connector);
+}
+
+/* Configurations are looked up by their list of output keys, in the
+   same order as the outputs of the monitor manager, which sorts them
+   by connector. Bring loaded configurations into that order, the file
+   might have been written by someone else.
+*/
+static void
+config_sort (MetaConfiguration *config)
+{
+  MetaOutputKey *keys;
+  MetaOutputConfig *outputs;
+  unsigned int *order;
+  unsigned int i;
+
+  order = g_new (unsigned int, config->n_outputs);
+  for (i = 0; i < config->n_outputs; i++)
+    order[i] = i;
+
+  g_qsort_with_data (order, config->n_outputs, sizeof (unsigned int),
+                     compare_output_keys, config);
+
+  keys = g_new (MetaOutputKey, config->n_outputs);
+  outputs = g_new (MetaOutputConfig, config->n_outputs);
+  for (i = 0; i < config->n_outputs; i++)
+    {
+      keys[i] = config->keys[order[i]];
+      outputs[i] = config->outputs[order[i]];
+    }
+
+  g_free (config->keys);
+  g_free (config->outputs);
+  config->keys = keys;
+  config->outputs = outputs;
+
+  g_free (order);
+}
+
 static unsigned int
 config_hash (gconstpointer data)
 {
@@ -239,12 +289,25 @@ meta_monitor_config_init (MetaMonitorConfig *self)
                            G_CALLBACK (power_client_changed_cb), self, 0);
 }
 
+static void
+meta_monitor_config_dispose (GObject *object)
+{
+  MetaMonitorConfig *self = META_MONITOR_CONFIG (object);
+
+  meta_monitor_config_flush (self);
+
+  G_OBJECT_CLASS (meta_monitor_config_parent_class)->dispose (object);
+}
+
 static void
 meta_monitor_config_finalize (GObject *object)
 {
   MetaMonitorConfig *self = META_MONITOR_CONFIG (object);
 
   g_hash_table_destroy (self->configs);
+  g_free (self->saved_contents);
+
+  G_OBJECT_CLASS (meta_monitor_config_parent_class)->finalize (object);
 }
 
 static void
@@ -252,6 +315,7 @@ meta_monitor_config_class_init (MetaMonitorConfigClass *klass)
 {
   GObjectClass *object_class = G_OBJECT_CLASS (klass);
 
+  object_class->dispose = meta_monitor_config_dispose;
   object_class->finalize = meta_monitor_config_finalize;
 }
 
@@ -431,6 +495,7 @@ handle_end_element (GMarkupParseContext  *context,
             config->n_outputs = parser->key_array->len;
             config->keys = (void*)g_array_free (parser->key_array, FALSE);
             config->outputs = (void*)g_array_free (parser->output_array, FALSE);
+            config_sort (config);
 
             g_hash_table_replace (parser->config->configs, config, config);
 
@@ -801,6 +866,37 @@ make_config_key (MetaConfiguration *key,
   key->n_outputs = o;
 }
 
+/* Like make_config_key(), but the key borrows the strings of the
+   outputs, and its keys array is provided by the caller, so that
+   lookups don't allocate anything. Don't config_clear() it.
+*/
+static void
+make_lookup_key (MetaConfiguration *key,
+                 MetaOutputKey     *keys,
+                 MetaOutput        *outputs,
+                 unsigned           n_outputs,
+                 unsigned           skip)
+{
+  unsigned int o, i;
+
+  key->outputs = NULL;
+  key->keys = keys;
+
+  for (o = 0, i = 0; i < n_outputs; i++)
+    {
+      if (i == skip)
+        continue;
+
+      keys[o].connector = outputs[i].name;
+      keys[o].vendor = outputs[i].vendor;
+      keys[o].product = outputs[i].product;
+      keys[o].serial = outputs[i].serial;
+      o++;
+    }
+
+  key->n_outputs = o;
+}
+
 gboolean
 meta_monitor_config_match_current (MetaMonitorConfig  *self,
                                    MetaMonitorManager *manager)
@@ -808,18 +904,15 @@ meta_monitor_config_match_current (MetaMonitorConfig  *self,
   MetaOutput *outputs;
   unsigned n_outputs;
   MetaConfiguration key;
-  gboolean ok;
 
   if (self->current == NULL)
     return FALSE;
 
   outputs = meta_monitor_manager_get_outputs (manager, &n_outputs);
 
-  make_config_key (&key, outputs, n_outputs, -1);
-  ok = config_equal (&key, self->current);
-
-  config_clear (&key);
-  return ok;
+  make_lookup_key (&key, g_newa (MetaOutputKey, n_outputs),
+                   outputs, n_outputs, -1);
+  return config_equal (&key, self->current);
 }
 
 gboolean
@@ -844,16 +937,13 @@ meta_monitor_config_get_stored (MetaMonitorConfig *self,
 				unsigned           n_outputs)
 {
   MetaConfiguration key;
-  MetaConfiguration *stored;
 
   if (n_outputs == 0)
     return NULL;
 
-  make_config_key (&key, outputs, n_outputs, -1);
-  stored = g_hash_table_lookup (self->configs, &key);
-
-  config_clear (&key);
-  return stored;
+  make_lookup_key (&key, g_newa (MetaOutputKey, n_outputs),
+                   outputs, n_outputs, -1);
+  return g_hash_table_lookup (self->configs, &key);
 }
 
 static gboolean
@@ -1080,6 +1170,7 @@ make_default_config (MetaMonitorConfig *self,
   int x, y;
   MetaConfiguration *ret;
   MetaOutput *primary;
+  MetaOutputKey *lookup_keys;
 
   ret = g_slice_new (MetaConfiguration);
   make_config_key (ret, outputs, n_outputs, -1);
@@ -1114,14 +1205,14 @@ make_default_config (MetaMonitorConfig *self,
   */
   x = 0;
   y = 0;
+  lookup_keys = g_newa (MetaOutputKey, n_outputs);
   for (i = 0; i < n_outputs; i++)
     {
       MetaConfiguration key;
       MetaConfiguration *ref;
 
-      make_config_key (&key, outputs, n_outputs, i);
+      make_lookup_key (&key, lookup_keys, outputs, n_outputs, i);
       ref = g_hash_table_lookup (self->configs, &key);
-      config_clear (&key);
 
       if (ref)
         {
@@ -1392,39 +1483,13 @@ power_client_changed_cb (UpClient *client,
     }
 }
 
-typedef struct {
-  MetaMonitorConfig *config;
-  GString *buffer;
-} SaveClosure;
+/* Changes are written out this long after the last one, so that
+   several of them in a row, as when a dock is plugged in and out,
+   only cause one write */
+#define SAVE_DELAY_SECONDS 2
 
-static void
-saved_cb (GObject      *object,
-          GAsyncResult *result,
-          gpointer      user_data)
-{
-  SaveClosure *closure = user_data;
-  GError *error;
-  gboolean ok;
-
-  error = NULL;
-  ok = g_file_replace_contents_finish (G_FILE (object), result, NULL, &error);
-  if (!ok)
-    {
-      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
-        meta_warning ("Saving monitor configuration failed: %s\n", error->message);
-
-      g_error_free (error);
-    }
-
-  g_clear_object (&closure->config->save_cancellable);
-  g_object_unref (closure->config);
-  g_string_free (closure->buffer, TRUE);
-
-  g_slice_free (SaveClosure, closure);
-}
-
-static void
-meta_monitor_config_save (MetaMonitorConfig *self)
+static GString *
+meta_monitor_config_to_xml (MetaMonitorConfig *self)
 {
   static const char * const rotation_map[4] = {
     "normal",
@@ -1432,21 +1497,11 @@ meta_monitor_config_save (MetaMonitorConfig *self)
     "upside_down",
     "right"
   };
-  SaveClosure *closure;
   GString *buffer;
   GHashTableIter iter;
   MetaConfiguration *config;
   unsigned int i;
 
-  if (self->save_cancellable)
-    {
-      g_cancellable_cancel (self->save_cancellable);
-      g_object_unref (self->save_cancellable);
-      self->save_cancellable = NULL;
-    }
-
-  self->save_cancellable = g_cancellable_new ();
-
   buffer = g_string_new ("<monitors version=\"1\">\n");
 
   g_hash_table_iter_init (&iter, self->configs);
@@ -1511,17 +1566,146 @@ meta_monitor_config_save (MetaMonitorConfig *self)
 
   g_string_append (buffer, "</monitors>\n");
 
-  closure = g_slice_new (SaveClosure);
-  closure->config = g_object_ref (self);
-  closure->buffer = buffer;
+  return buffer;
+}
+
+static void meta_monitor_config_save (MetaMonitorConfig *self);
+
+static void
+saved_cb (GObject      *object,
+          GAsyncResult *result,
+          gpointer      user_data)
+{
+  MetaMonitorConfig *self = user_data;
+  GError *error;
+  gboolean ok;
+
+  error = NULL;
+  ok = g_file_replace_contents_finish (G_FILE (object), result, NULL, &error);
+  if (!ok)
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        meta_warning ("Saving monitor configuration failed: %s\n", error->message);
+
+      g_error_free (error);
+
+      /* Don't skip the next attempt because it has the same contents */
+      g_free (self->saved_contents);
+      self->saved_contents = NULL;
+    }
+
+  g_clear_object (&self->save_cancellable);
+
+  /* Something changed while we were writing */
+  if (self->save_pending)
+    meta_monitor_config_save (self);
+
+  g_object_unref (self);
+}
+
+/* Writes the stored configurations to disk, unless they are what was
+   written last time. g_file_replace_contents_async() does the I/O in
+   a worker thread, and writes to a temporary file that is renamed
+   over the old one, so the file is never seen half written.
+*/
+static void
+meta_monitor_config_save (MetaMonitorConfig *self)
+{
+  GString *buffer;
 
+  /* Only one write at a time, saved_cb() starts the next one */
+  if (self->save_cancellable)
+    {
+      self->save_pending = TRUE;
+      return;
+    }
+
+  self->save_pending = FALSE;
+
+  buffer = meta_monitor_config_to_xml (self);
+
+  if (self->saved_contents && strcmp (self->saved_contents, buffer->str) == 0)
+    {
+      g_string_free (buffer, TRUE);
+      return;
+    }
+
+  g_free (self->saved_contents);
+  self->saved_contents = g_string_free (buffer, FALSE);
+
+  self->save_cancellable = g_cancellable_new ();
+
+  /* saved_contents stays alive until the write is done: it is only
+     replaced from here, and we don't get here again before saved_cb() */
   g_file_replace_contents_async (self->file,
-                                 buffer->str, buffer->len,
+                                 self->saved_contents,
+                                 strlen (self->saved_contents),
                                  NULL, /* etag */
                                  TRUE,
                                  G_FILE_CREATE_REPLACE_DESTINATION,
                                  self->save_cancellable,
-                                 saved_cb, closure);
+                                 saved_cb, g_object_ref (self));
+}
+
+static gboolean
+save_timeout (gpointer user_data)
+{
+  MetaMonitorConfig *self = user_data;
+
+  self->save_id = 0;
+  meta_monitor_config_save (self);
+
+  return FALSE;
+}
+
+static void
+meta_monitor_config_queue_save (MetaMonitorConfig *self)
+{
+  if (self->save_id != 0)
+    g_source_remove (self->save_id);
+
+  self->save_id = g_timeout_add_seconds (SAVE_DELAY_SECONDS, save_timeout, self);
+}
+
+/* Writes out a queued save right away, and synchronously, since we
+   are going away and the main loop won't run again to finish an
+   asynchronous one. A write that is still in flight is cancelled and
+   done over, there may be newer changes queued behind it.
+*/
+void
+meta_monitor_config_flush (MetaMonitorConfig *self)
+{
+  GString *buffer;
+  GError *error;
+
+  if (self->save_id == 0 && self->save_cancellable == NULL)
+    return;
+
+  if (self->save_id != 0)
+    {
+      g_source_remove (self->save_id);
+      self->save_id = 0;
+    }
+
+  if (self->save_cancellable)
+    g_cancellable_cancel (self->save_cancellable);
+  self->save_pending = FALSE;
+
+  buffer = meta_monitor_config_to_xml (self);
+
+  error = NULL;
+  if (!g_file_replace_contents (self->file,
+                                buffer->str, buffer->len,
+                                NULL, /* etag */
+                                TRUE,
+                                G_FILE_CREATE_REPLACE_DESTINATION,
+                                NULL, NULL, &error))
+    {
+      meta_warning ("Saving monitor configuration failed: %s\n", error->message);
+      g_error_free (error);
+    }
+
+  g_string_free (buffer, TRUE);
 }
 
 void
@@ -1537,17 +1721,29 @@ meta_monitor_config_make_persistent (MetaMonitorConfig *self)
     config_free (self->previous);
   self->previous = NULL;
 
-  meta_monitor_config_save (self);
+  meta_monitor_config_queue_save (self);
 }
 
 /*
  * CRTC assignment
  */
+typedef struct
+{
+  MetaOutput *output;
+  GPtrArray  *crtcs;
+  GPtrArray  *modes;
+} OutputCandidates;
+
 typedef struct
 {
   MetaConfiguration  *config;
   MetaMonitorManager *manager;
   GHashTable         *info;
+
+  /* Indexed like config->outputs, only filled for enabled outputs */
+  OutputCandidates   *candidates;
+  /* Keys of the partial assignments known not to lead anywhere */
+  GHashTable         *failed;
 } CrtcAssignment;
 
 static gboolean
@@ -1617,15 +1813,9 @@ crtc_assignment_assign (CrtcAssignment            *assign,
 {
   MetaCRTCInfo *info = g_hash_table_lookup (assign->info, crtc);
 
-  if (!crtc_can_drive_output (crtc, output))
-    return FALSE;
-
-  if (!output_supports_mode (output, mode))
-    return FALSE;
-
-  if ((crtc->all_transforms & (1 << transform)) == 0)
-    return FALSE;
-
+  /* Whether the CRTC can drive the output in this mode and transform
+   * was already checked when building the candidate lists.
+   */
   if (info)
     {
       if (!(info->mode == mode	&&
@@ -1698,121 +1888,279 @@ find_output_by_key (MetaOutput    *outputs,
   return NULL;
 }
 
+static gboolean
+mode_matches_config (MetaMonitorMode  *mode,
+                     MetaOutputConfig *output_config,
+                     MetaOutput       *output)
+{
+  int width, height;
+  int config_width, config_height;
+
+  if (meta_monitor_transform_is_rotated (output_config->transform))
+    {
+      width = mode->height;
+      height = mode->width;
+    }
+  else
+    {
+      width = mode->width;
+      height = mode->height;
+    }
+
+  config_width = output_config->rect.width;
+  config_height = output_config->rect.height;
+
+  if (output_config->is_underscanning && !output->is_underscanning)
+    {
+      width -= round(width * OVERSCAN_COMPENSATION_BORDER) * 2;
+      height -= round(height * OVERSCAN_COMPENSATION_BORDER) * 2;
+    }
+  else if (!output_config->is_underscanning &&
+           !output_config->is_default_config &&
+           output->is_underscanning)
+    {
+      config_width -= round(config_width * OVERSCAN_COMPENSATION_BORDER) * 2;
+      config_height -= round(config_height * OVERSCAN_COMPENSATION_BORDER) * 2;
+    }
+
+  return width == config_width && height == config_height;
+}
+
+/* Narrows down the CRTCs and modes an output can possibly use for
+ * its configuration, in the order they should be tried.
+ */
+static void
+output_candidates_init (OutputCandidates   *candidates,
+                        MetaMonitorManager *manager,
+                        MetaOutputConfig   *output_config,
+                        MetaOutput         *output)
+{
+  MetaMonitorMode *modes;
+  MetaCRTC *crtcs;
+  MetaOutput *outputs;
+  unsigned int n_crtcs, n_modes, n_outputs;
+  MetaMonitorMode *current_mode;
+  unsigned int i, pass;
+
+  meta_monitor_manager_get_resources (manager,
+                                      &modes, &n_modes,
+                                      &crtcs, &n_crtcs,
+                                      &outputs, &n_outputs);
+
+  candidates->output = output;
+  candidates->crtcs = g_ptr_array_new ();
+  candidates->modes = g_ptr_array_new ();
+
+  /* Try the CRTC that is already driving the output first, so that
+   * reapplying an unchanged layout finds the current assignment
+   * straight away, and doesn't shuffle CRTCs around.
+   */
+  if (output->crtc &&
+      crtc_can_drive_output (output->crtc, output) &&
+      (output->crtc->all_transforms & (1 << output_config->transform)))
+    g_ptr_array_add (candidates->crtcs, output->crtc);
+
+  for (i = 0; i < n_crtcs; i++)
+    {
+      MetaCRTC *crtc = &crtcs[i];
+
+      if (crtc == output->crtc)
+        continue;
+
+      if (!crtc_can_drive_output (crtc, output))
+        continue;
+
+      if ((crtc->all_transforms & (1 << output_config->transform)) == 0)
+        continue;
+
+      g_ptr_array_add (candidates->crtcs, crtc);
+    }
+
+  current_mode = output->crtc ? output->crtc->current_mode : NULL;
+
+  /* Make two passes, one where frequencies must match, then
+   * one where they don't have to
+   */
+  for (pass = 0; pass < 2; pass++)
+    {
+      if (pass == 0 && current_mode &&
+          output_supports_mode (output, current_mode) &&
+          mode_matches_config (current_mode, output_config, output) &&
+          current_mode->refresh_rate == output_config->refresh_rate)
+        g_ptr_array_add (candidates->modes, current_mode);
+
+      for (i = 0; i < n_modes; i++)
+        {
+          MetaMonitorMode *mode = &modes[i];
+          gboolean refresh_matches;
+
+          if (pass == 0 && mode == current_mode)
+            continue;
+
+          refresh_matches = (mode->refresh_rate == output_config->refresh_rate);
+          if (refresh_matches != (pass == 0))
+            continue;
+
+          if (!mode_matches_config (mode, output_config, output))
+            continue;
+
+          if (!output_supports_mode (output, mode))
+            continue;
+
+          g_ptr_array_add (candidates->modes, mode);
+        }
+    }
+}
+
+static void
+output_candidates_clear (OutputCandidates *candidates)
+{
+  if (candidates->crtcs)
+    g_ptr_array_free (candidates->crtcs, TRUE);
+  if (candidates->modes)
+    g_ptr_array_free (candidates->modes, TRUE);
+}
+
+/* Whether any output from output_num onwards could be cloned onto
+ * the CRTC described by info.
+ */
+static gboolean
+crtc_info_has_pending_clones (CrtcAssignment *assignment,
+                              MetaCRTCInfo   *info,
+                              unsigned int    output_num)
+{
+  unsigned int i;
+
+  for (i = output_num; i < assignment->config->n_outputs; i++)
+    {
+      MetaOutputConfig *output_config = &assignment->config->outputs[i];
+
+      if (output_config->enabled &&
+          output_config->rect.x == info->x &&
+          output_config->rect.y == info->y &&
+          output_config->transform == info->transform)
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+/* Describes what is left to solve once outputs before output_num
+ * have been assigned. A busy CRTC that no remaining output can join
+ * is just busy, whatever mode it was given, so searches that only
+ * differ in the modes picked for earlier outputs share their key.
+ */
+static char *
+crtc_assignment_make_key (CrtcAssignment *assignment,
+                          unsigned int    output_num)
+{
+  MetaMonitorMode *modes;
+  MetaCRTC *crtcs;
+  MetaOutput *outputs;
+  unsigned int n_crtcs, n_modes, n_outputs;
+  GString *key;
+  unsigned int i, j;
+
+  meta_monitor_manager_get_resources (assignment->manager,
+                                      &modes, &n_modes,
+                                      &crtcs, &n_crtcs,
+                                      &outputs, &n_outputs);
+
+  key = g_string_new (NULL);
+  g_string_append_printf (key, "%u", output_num);
+
+  for (i = 0; i < n_crtcs; i++)
+    {
+      MetaCRTCInfo *info = g_hash_table_lookup (assignment->info, &crtcs[i]);
+
+      if (info == NULL)
+        continue;
+
+      g_string_append_printf (key, " %u", i);
+
+      if (!crtc_info_has_pending_clones (assignment, info, output_num))
+        continue;
+
+      g_string_append_printf (key, ":%d:%d:%d:%d",
+                              (int) (info->mode - modes),
+                              info->x, info->y, info->transform);
+
+      for (j = 0; j < info->outputs->len; j++)
+        g_string_append_printf (key, ":%d",
+                                (int) ((MetaOutput *) info->outputs->pdata[j] - outputs));
+    }
+
+  return g_string_free (key, FALSE);
+}
+
 /* Check whether the given set of settings can be used
  * at the same time -- ie. whether there is an assignment
  * of CRTC's to outputs.
  *
- * Brute force - the number of objects involved is small
- * enough that it doesn't matter.
+ * Depth first over the precomputed candidates of each output.
+ * With many outputs sharing few CRTCs the plain search explodes
+ * when there is no solution, so partial assignments that failed
+ * once are remembered and not searched again.
  */
 static gboolean
 real_assign_crtcs (CrtcAssignment     *assignment,
                    unsigned int        output_num)
 {
-  MetaMonitorMode *modes;
-  MetaCRTC *crtcs;
-  MetaOutput *outputs;
-  unsigned int n_crtcs, n_modes, n_outputs;
-  MetaOutputKey *output_key;
+  OutputCandidates *candidates;
   MetaOutputConfig *output_config;
-  unsigned int i;
-  gboolean success;
+  char *key;
+  unsigned int i, j;
 
   if (output_num == assignment->config->n_outputs)
     return TRUE;
 
-  output_key = &assignment->config->keys[output_num];
   output_config = &assignment->config->outputs[output_num];
 
   /* It is always allowed for an output to be turned off */
   if (!output_config->enabled)
     return real_assign_crtcs (assignment, output_num + 1);
 
-  meta_monitor_manager_get_resources (assignment->manager,
-                                      &modes, &n_modes,
-                                      &crtcs, &n_crtcs,
-                                      &outputs, &n_outputs);
+  key = crtc_assignment_make_key (assignment, output_num);
+  if (g_hash_table_lookup (assignment->failed, key))
+    {
+      g_free (key);
+      return FALSE;
+    }
 
-  success = FALSE;
+  candidates = &assignment->candidates[output_num];
 
-  for (i = 0; i < n_crtcs; i++)
+  for (i = 0; i < candidates->crtcs->len; i++)
     {
-      MetaCRTC *crtc = &crtcs[i];
-      unsigned int pass;
-
-      /* Make two passes, one where frequencies must match, then
-       * one where they don't have to
-       */
-      for (pass = 0; pass < 2; pass++)
-	{
-          MetaOutput *output = find_output_by_key (outputs, n_outputs, output_key);
-          unsigned int j;
-
-          for (j = 0; j < n_modes; j++)
-	    {
-              MetaMonitorMode *mode = &modes[j];
-              int width, height;
-              int config_width, config_height;
-
-              if (meta_monitor_transform_is_rotated (output_config->transform))
-                {
-                  width = mode->height;
-                  height = mode->width;
-                }
-              else
-                {
-                  width = mode->width;
-                  height = mode->height;
-                }
+      MetaCRTC *crtc = candidates->crtcs->pdata[i];
 
-              config_width = output_config->rect.width;
-              config_height = output_config->rect.height;
-
-              if (output_config->is_underscanning && !output->is_underscanning)
-                {
-                  width -= round(width * OVERSCAN_COMPENSATION_BORDER) * 2;
-                  height -= round(height * OVERSCAN_COMPENSATION_BORDER) * 2;
-                }
-              else if (!output_config->is_underscanning &&
-                       !output_config->is_default_config &&
-                       output->is_underscanning)
+      for (j = 0; j < candidates->modes->len; j++)
+        {
+          MetaMonitorMode *mode = candidates->modes->pdata[j];
+
+          meta_verbose ("CRTC %ld: trying mode %dx%d@%fHz with output at %dx%d@%fHz (transform %d)\n",
+                        crtc->crtc_id,
+                        mode->width, mode->height, mode->refresh_rate,
+                        output_config->rect.width, output_config->rect.height, output_config->refresh_rate,
+                        output_config->transform);
+
+          if (crtc_assignment_assign (assignment, crtc, mode,
+                                      output_config->rect.x, output_config->rect.y,
+                                      output_config->transform,
+                                      candidates->output))
+            {
+              if (real_assign_crtcs (assignment, output_num + 1))
                 {
-                  config_width -= round(config_width * OVERSCAN_COMPENSATION_BORDER) * 2;
-                  config_height -= round(config_height * OVERSCAN_COMPENSATION_BORDER) * 2;
+                  g_free (key);
+                  return TRUE;
                 }
 
-              if (width == config_width &&
-                  height == config_height &&
-                  (pass == 1 || mode->refresh_rate == output_config->refresh_rate))
-		{
-                  meta_verbose ("CRTC %ld: trying mode %dx%d@%fHz with output at %dx%d@%fHz (transform %d) (pass %d)\n",
-                                crtc->crtc_id,
-                                mode->width, mode->height, mode->refresh_rate,
-                                output_config->rect.width, output_config->rect.height, output_config->refresh_rate,
-                                output_config->transform,
-                                pass);
-
-
-                  if (crtc_assignment_assign (assignment, crtc, &modes[j],
-                                              output_config->rect.x, output_config->rect.y,
-                                              output_config->transform,
-                                              output))
-                    {
-                      if (real_assign_crtcs (assignment, output_num + 1))
-                        {
-                          success = TRUE;
-                          goto out;
-                        }
-
-                      crtc_assignment_unassign (assignment, crtc, output);
-                    }
-                }
+              crtc_assignment_unassign (assignment, crtc, candidates->output);
             }
-	}
+        }
     }
 
-out:
-  return success;
+  g_hash_table_insert (assignment->failed, key, key);
+  return FALSE;
 }
 
 static gboolean
@@ -1828,12 +2176,41 @@ meta_monitor_config_assign_crtcs (MetaConfiguration  *config,
   unsigned int i;
   MetaOutput *all_outputs;
   unsigned int n_outputs;
+  gboolean success;
+
+  all_outputs = meta_monitor_manager_get_outputs (manager,
+                                                  &n_outputs);
+  g_assert (n_outputs == config->n_outputs);
 
   assignment.config = config;
   assignment.manager = manager;
   assignment.info = g_hash_table_new_full (NULL, NULL, NULL, (GDestroyNotify)meta_crtc_info_free);
+  assignment.candidates = g_new0 (OutputCandidates, n_outputs);
+  assignment.failed = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
 
-  if (!real_assign_crtcs (&assignment, 0))
+  for (i = 0; i < n_outputs; i++)
+    {
+      if (!config->outputs[i].enabled)
+        continue;
+
+      output_candidates_init (&assignment.candidates[i], manager,
+                              &config->outputs[i],
+                              find_output_by_key (all_outputs, n_outputs,
+                                                  &config->keys[i]));
+    }
+
+  success = real_assign_crtcs (&assignment, 0);
+
+  meta_verbose ("CRTC assignment %s, %u dead ends remembered\n",
+                success ? "found" : "not found",
+                g_hash_table_size (assignment.failed));
+
+  for (i = 0; i < n_outputs; i++)
+    output_candidates_clear (&assignment.candidates[i]);
+  g_free (assignment.candidates);
+  g_hash_table_destroy (assignment.failed);
+
+  if (!success)
     {
       meta_warning ("Could not assign CRTC to outputs, ignoring configuration\n");
 
@@ -1848,10 +2225,6 @@ meta_monitor_config_assign_crtcs (MetaConfiguration  *config,
       g_ptr_array_add (crtcs, info);
     }
 
-  all_outputs = meta_monitor_manager_get_outputs (manager,
-                                                  &n_outputs);
-  g_assert (n_outputs == config->n_outputs);
-
   for (i = 0; i < n_outputs; i++)
     {
       MetaOutputInfo *output_info = g_slice_new (MetaOutputInfo);
@@ -392,6 +392,8 @@ void               meta_monitor_config_update_current (MetaMonitorConfig  *confi
                                                        MetaMonitorManager *manager);
 void               meta_monitor_config_make_persistent (MetaMonitorConfig *config);
 
+void               meta_monitor_config_flush (MetaMonitorConfig *config);
+
 void               meta_monitor_config_restore_previous (MetaMonitorConfig  *config,
                                                          MetaMonitorManager *manager);
 
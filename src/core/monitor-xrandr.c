@@ -58,6 +58,12 @@ struct _MetaMonitorManagerXrandr
   int time;
   int rr_event_base;
   int rr_error_base;
+
+  /* Raw EDIDs of the connected outputs, by output XID (NULL if the
+     output has none), and parsed EDIDs, by EDID contents. Both only
+     keep what the last read_current() used. */
+  GHashTable *edids;
+  GHashTable *parsed_edids;
 };
 
 struct _MetaMonitorManagerXrandrClass
@@ -369,6 +375,135 @@ read_output_edid (MetaMonitorManagerXrandr *manager_xrandr,
   return NULL;
 }
 
+static gboolean
+is_edid_atom (MetaMonitorManagerXrandr *manager_xrandr,
+              Atom                      atom)
+{
+  return (atom == XInternAtom (manager_xrandr->xdisplay, "EDID", FALSE) ||
+          atom == XInternAtom (manager_xrandr->xdisplay, "EDID_DATA", FALSE) ||
+          atom == XInternAtom (manager_xrandr->xdisplay, "XFree86_DDC_EDID1_RAWDATA", FALSE));
+}
+
+static void
+free_edid (gpointer data)
+{
+  if (data)
+    g_bytes_unref (data);
+}
+
+static GHashTable *
+edid_table_new (void)
+{
+  return g_hash_table_new_full (NULL, NULL, NULL, free_edid);
+}
+
+static GHashTable *
+parsed_edid_table_new (void)
+{
+  return g_hash_table_new_full (g_bytes_hash, g_bytes_equal,
+                                (GDestroyNotify) g_bytes_unref, g_free);
+}
+
+/* Returns the EDID of the output, reusing the one read for the
+ * previous configuration unless an event said it changed. Whatever is
+ * found is moved from old_edids into the current table, so outputs
+ * that went away are dropped with the old table.
+ */
+static GBytes *
+get_output_edid (MetaMonitorManagerXrandr *manager_xrandr,
+                 GHashTable               *old_edids,
+                 XID                       output_id)
+{
+  gpointer key = GINT_TO_POINTER (output_id);
+  gpointer edid;
+
+  if (g_hash_table_lookup_extended (manager_xrandr->edids, key, NULL, &edid))
+    return edid;
+
+  if (g_hash_table_lookup_extended (old_edids, key, NULL, &edid))
+    g_hash_table_steal (old_edids, key);
+  else
+    edid = read_output_edid (manager_xrandr, output_id);
+
+  g_hash_table_insert (manager_xrandr->edids, key, edid);
+  return edid;
+}
+
+/* Same as get_output_edid(), for the result of decode_edid(), so a
+ * monitor that comes back, or moves to another connector, isn't
+ * parsed again. Returns NULL if the EDID couldn't be parsed.
+ */
+static MonitorInfo *
+get_parsed_edid (MetaMonitorManagerXrandr *manager_xrandr,
+                 GHashTable               *old_parsed_edids,
+                 GBytes                   *edid)
+{
+  gpointer key, parsed_edid;
+
+  if (g_hash_table_lookup_extended (manager_xrandr->parsed_edids, edid, NULL, &parsed_edid))
+    return parsed_edid;
+
+  if (g_hash_table_lookup_extended (old_parsed_edids, edid, &key, &parsed_edid))
+    {
+      g_hash_table_steal (old_parsed_edids, edid);
+    }
+  else
+    {
+      key = g_bytes_ref (edid);
+      parsed_edid = decode_edid (g_bytes_get_data (edid, NULL));
+    }
+
+  g_hash_table_insert (manager_xrandr->parsed_edids, key, parsed_edid);
+  return parsed_edid;
+}
+
+/* Forgets the EDID of an output when an RRNotify event says it might
+ * have changed, so that the next read_current() fetches it again.
+ */
+static gboolean
+invalidate_output_edid (MetaMonitorManagerXrandr *manager_xrandr,
+                        XEvent                   *event)
+{
+  XRRNotifyEvent *notify_event = (XRRNotifyEvent *) event;
+  RROutput output;
+
+  if ((event->type - manager_xrandr->rr_event_base) != RRNotify)
+    return FALSE;
+
+  switch (notify_event->subtype)
+    {
+    case RRNotify_OutputChange:
+      output = ((XRROutputChangeNotifyEvent *) event)->output;
+      break;
+    case RRNotify_OutputProperty:
+      {
+        XRROutputPropertyNotifyEvent *property_event = (XRROutputPropertyNotifyEvent *) event;
+
+        if (!is_edid_atom (manager_xrandr, property_event->property))
+          return TRUE;
+
+        output = property_event->output;
+      }
+      break;
+    default:
+      return TRUE;
+    }
+
+  g_hash_table_remove (manager_xrandr->edids, GINT_TO_POINTER (output));
+  return TRUE;
+}
+
+static Bool
+invalidate_queued_edid (Display  *xdisplay,
+                        XEvent   *event,
+                        XPointer  data)
+{
+  invalidate_output_edid ((MetaMonitorManagerXrandr *) data, event);
+
+  /* Leave the event in the queue, it is handled when its turn comes */
+  return False;
+}
+
 static gboolean
 output_get_hotplug_mode_update (MetaMonitorManagerXrandr *manager_xrandr,
                                 XID                       output_id)
@@ -513,6 +648,7 @@ meta_monitor_manager_xrandr_read_current (MetaMonitorManager *manager)
   Screen *screen;
   BOOL dpms_capable, dpms_enabled;
   CARD16 dpms_state;
+  GHashTable *old_edids, *old_parsed_edids;
 
   if (manager_xrandr->resources)
     XRRFreeScreenResources (manager_xrandr->resources);
@@ -635,6 +771,11 @@ meta_monitor_manager_xrandr_read_current (MetaMonitorManager *manager)
 					DefaultRootWindow (manager_xrandr->xdisplay));
   meta_error_trap_pop (meta_get_display ());
 
+  old_edids = manager_xrandr->edids;
+  old_parsed_edids = manager_xrandr->parsed_edids;
+  manager_xrandr->edids = edid_table_new ();
+  manager_xrandr->parsed_edids = parsed_edid_table_new ();
+
   n_actual_outputs = 0;
   for (i = 0; i < (unsigned)resources->noutput; i++)
     {
@@ -667,12 +808,10 @@ meta_monitor_manager_xrandr_read_current (MetaMonitorManager *manager)
 		}
 	    }
 
-          edid = read_output_edid (manager_xrandr, meta_output->output_id);
+          edid = get_output_edid (manager_xrandr, old_edids, meta_output->output_id);
           if (edid)
             {
-              gsize len;
-
-              parsed_edid = decode_edid (g_bytes_get_data (edid, &len));
+              parsed_edid = get_parsed_edid (manager_xrandr, old_parsed_edids, edid);
               if (parsed_edid)
                 {
                   meta_output->vendor = g_strndup (parsed_edid->manufacturer_code, 4);
@@ -686,10 +825,7 @@ meta_monitor_manager_xrandr_read_current (MetaMonitorManager *manager)
                     meta_output->serial = g_strdup_printf ("0x%08x", parsed_edid->serial_number);
 
                   hdmi_vga_detect(meta_output, edid, parsed_edid);
-                  g_free (parsed_edid);
                 }
-
-              g_bytes_unref (edid);
             }
 
           if (!meta_output->vendor)
@@ -760,6 +896,10 @@ meta_monitor_manager_xrandr_read_current (MetaMonitorManager *manager)
 
   manager->n_outputs = n_actual_outputs;
 
+  /* Whatever is left belongs to outputs that went away or changed */
+  g_hash_table_destroy (old_edids);
+  g_hash_table_destroy (old_parsed_edids);
+
   /* Sort the outputs for easier handling in MetaMonitorConfig */
   qsort (manager->outputs, manager->n_outputs, sizeof (MetaOutput), compare_outputs);
 
@@ -791,6 +931,11 @@ meta_monitor_manager_xrandr_read_edid (MetaMonitorManager *manager,
                                        MetaOutput         *output)
 {
   MetaMonitorManagerXrandr *manager_xrandr = META_MONITOR_MANAGER_XRANDR (manager);
+  GBytes *edid;
+
+  edid = g_hash_table_lookup (manager_xrandr->edids, GINT_TO_POINTER (output->output_id));
+  if (edid)
+    return g_bytes_ref (edid);
 
   return read_output_edid (manager_xrandr, output->output_id);
 }
@@ -1293,12 +1438,22 @@ meta_monitor_manager_xrandr_handle_xevent (MetaMonitorManager *manager,
   gboolean new_config;
   unsigned i, j;
   gboolean needs_update = FALSE;
+  XEvent dummy;
+
+  if (invalidate_output_edid (manager_xrandr, event))
+    return TRUE;
 
   if ((event->type - manager_xrandr->rr_event_base) != RRScreenChangeNotify)
     return FALSE;
 
   XRRUpdateConfiguration (event);
 
+  /* The server sends the output events for a hotplug after the screen
+     event, so look ahead for them before deciding which EDIDs can be
+     reused */
+  XCheckIfEvent (manager_xrandr->xdisplay, &dummy,
+                 invalidate_queued_edid, (XPointer) manager_xrandr);
+
   /* Save the old structures, so they stay valid during the update */
   old_outputs = manager->outputs;
   n_old_outputs = manager->n_outputs;
@@ -1450,6 +1605,8 @@ meta_monitor_manager_xrandr_init (MetaMonitorManagerXrandr *manager_xrandr)
   MetaDisplay *display = meta_get_display ();
 
   manager_xrandr->xdisplay = display->xdisplay;
+  manager_xrandr->edids = edid_table_new ();
+  manager_xrandr->parsed_edids = parsed_edid_table_new ();
 
   if (!XRRQueryExtension (manager_xrandr->xdisplay,
 			  &manager_xrandr->rr_event_base,
@@ -1459,12 +1616,14 @@ meta_monitor_manager_xrandr_init (MetaMonitorManagerXrandr *manager_xrandr)
     }
   else
     {
-      /* We only use ScreenChangeNotify, but GDK uses the others,
-	 and we don't want to step on its toes */
+      /* We use ScreenChangeNotify, and the output events to know
+	 which EDIDs changed; GDK uses the others, and we don't want
+	 to step on its toes */
       XRRSelectInput (manager_xrandr->xdisplay,
 		      DefaultRootWindow (manager_xrandr->xdisplay),
 		      RRScreenChangeNotifyMask
 		      | RRCrtcChangeNotifyMask
+		      | RROutputChangeNotifyMask
 		      | RROutputPropertyNotifyMask);
     }
 }
@@ -1478,6 +1637,9 @@ meta_monitor_manager_xrandr_finalize (GObject *object)
     XRRFreeScreenResources (manager_xrandr->resources);
   manager_xrandr->resources = NULL;
 
+  g_hash_table_destroy (manager_xrandr->edids);
+  g_hash_table_destroy (manager_xrandr->parsed_edids);
+
   G_OBJECT_CLASS (meta_monitor_manager_xrandr_parent_class)->finalize (object);
 }
 
@@ -61,9 +61,133 @@ G_DEFINE_TYPE_WITH_CODE (MetaMonitorManager, meta_monitor_manager, META_DBUS_TYP
 
 static void initialize_dbus_interface (MetaMonitorManager *manager);
 
+static const struct {
+  int width;
+  int height;
+} synthetic_sizes[] = {
+  { 3840, 2160 },
+  { 2560, 1440 },
+  { 1920, 1200 },
+  { 1920, 1080 },
+  { 1680, 1050 },
+  { 1600, 900 },
+  { 1366, 768 },
+  { 1280, 1024 },
+  { 1280, 720 },
+  { 1024, 768 },
+  { 800, 600 },
+  { 640, 480 },
+};
+
+static const float synthetic_refresh_rates[] = {
+  60.0, 59.94, 50.0, 30.0
+};
+
+/* Builds a dock-like topology from META_DEBUG_MULTIMONITOR_OUTPUTS,
+   "OUTPUTS[:CRTCS]": every output has all the synthetic modes and
+   can be driven by any CRTC, which is the worst case for the CRTC
+   assignment search. Output 0 starts out lit on CRTC 0 at 1920x1080.
+   Everything is generated deterministically, so that runs can be
+   compared with each other.
+*/
+static void
+read_current_dummy_synthetic (MetaMonitorManager *manager,
+                              unsigned int        n_outputs,
+                              unsigned int        n_crtcs)
+{
+  MetaMonitorMode *preferred;
+  unsigned int i, j;
+
+  manager->max_screen_width = 65535;
+  manager->max_screen_height = 65535;
+  manager->screen_width = 1920;
+  manager->screen_height = 1080;
+
+  manager->n_modes = G_N_ELEMENTS (synthetic_sizes) * G_N_ELEMENTS (synthetic_refresh_rates);
+  manager->modes = g_new0 (MetaMonitorMode, manager->n_modes);
+
+  for (i = 0; i < manager->n_modes; i++)
+    {
+      manager->modes[i].mode_id = i + 1;
+      manager->modes[i].width = synthetic_sizes[i / G_N_ELEMENTS (synthetic_refresh_rates)].width;
+      manager->modes[i].height = synthetic_sizes[i / G_N_ELEMENTS (synthetic_refresh_rates)].height;
+      manager->modes[i].refresh_rate = synthetic_refresh_rates[i % G_N_ELEMENTS (synthetic_refresh_rates)];
+    }
+
+  /* 1920x1080@60 */
+  preferred = &manager->modes[3 * G_N_ELEMENTS (synthetic_refresh_rates)];
+
+  manager->n_crtcs = n_crtcs;
+  manager->crtcs = g_new0 (MetaCRTC, n_crtcs);
+
+  for (i = 0; i < n_crtcs; i++)
+    {
+      manager->crtcs[i].crtc_id = manager->n_modes + i + 1;
+      manager->crtcs[i].transform = WL_OUTPUT_TRANSFORM_NORMAL;
+      manager->crtcs[i].all_transforms = ALL_WL_TRANSFORMS;
+    }
+
+  manager->crtcs[0].rect.width = preferred->width;
+  manager->crtcs[0].rect.height = preferred->height;
+  manager->crtcs[0].current_mode = preferred;
+
+  manager->n_outputs = n_outputs;
+  manager->outputs = g_new0 (MetaOutput, n_outputs);
+
+  for (i = 0; i < n_outputs; i++)
+    {
+      MetaOutput *output = &manager->outputs[i];
+
+      output->crtc = (i == 0) ? &manager->crtcs[0] : NULL;
+      output->output_id = manager->n_modes + n_crtcs + i + 1;
+      output->name = g_strdup_printf ("DP-%u", i + 1);
+      output->vendor = g_strdup ("MetaProducts Inc.");
+      output->product = g_strdup ("unknown");
+      output->serial = g_strdup_printf ("0xD0C%03X", i);
+      output->width_mm = 510;
+      output->height_mm = 287;
+      output->subpixel_order = COGL_SUBPIXEL_ORDER_UNKNOWN;
+      output->preferred_mode = preferred;
+      output->n_modes = manager->n_modes;
+      output->modes = g_new0 (MetaMonitorMode *, manager->n_modes);
+      for (j = 0; j < manager->n_modes; j++)
+        output->modes[j] = &manager->modes[j];
+      output->n_possible_crtcs = n_crtcs;
+      output->possible_crtcs = g_new0 (MetaCRTC *, n_crtcs);
+      for (j = 0; j < n_crtcs; j++)
+        output->possible_crtcs[j] = &manager->crtcs[j];
+      output->n_possible_clones = 0;
+      output->possible_clones = g_new0 (MetaOutput *, 0);
+      output->backlight = -1;
+      output->backlight_min = 0;
+      output->backlight_max = 0;
+      output->is_primary = (i == 0);
+    }
+}
+
 static void
 read_current_dummy (MetaMonitorManager *manager)
 {
+  const char *env;
+
+  env = g_getenv ("META_DEBUG_MULTIMONITOR_OUTPUTS");
+  if (env != NULL)
+    {
+      unsigned int n_outputs, n_crtcs;
+      char *end;
+
+      n_outputs = strtoul (env, &end, 10);
+      n_crtcs = (*end == ':') ? strtoul (end + 1, NULL, 10) : n_outputs;
+
+      if (n_outputs > 0 && n_crtcs > 0)
+        {
+          read_current_dummy_synthetic (manager, n_outputs, n_crtcs);
+          return;
+        }
+
+      meta_warning ("Ignoring invalid META_DEBUG_MULTIMONITOR_OUTPUTS \"%s\"\n", env);
+    }
+
   /* The dummy monitor config has:
      - one enabled output, LVDS, primary, at 0x0 and 1024x768
      - one free CRTC
@@ -70,7 +70,8 @@
 
 #define SETTINGS(s) g_hash_table_lookup (settings_schemas, (s))
 
-static GList *changes = NULL;
+/* Preferences that changed since the last notification */
+static MetaPrefsChanges changes = 0;
 static guint changed_idle;
 static GList *listeners = NULL;
 static GHashTable *settings_schemas;
@@ -148,12 +149,18 @@ static void     do_override               (char *key, char *schema);
 static void     init_bindings             (void);
 
 
+/* A listener has either func, called once for each preference that
+ * changed, or changes_func, called once with all of them.
+ */
 typedef struct
 {
   MetaPrefsChangedFunc func;
+  MetaPrefsChangesFunc changes_func;
   gpointer data;
 } MetaPrefsListener;
 
+G_STATIC_ASSERT (META_PREF_AUTO_MAXIMIZE < 64);
+
 typedef struct
 {
   char *key;
@@ -810,34 +817,25 @@ handle_preference_update_int (GSettings *settings,
 /* Listeners.                                                               */
 /****************************************************************************/
 
-/**
- * meta_prefs_add_listener: (skip)
- * @func: a #MetaPrefsChangedFunc
- * @user_data: data passed to the function
- *
- */
-void
-meta_prefs_add_listener (MetaPrefsChangedFunc func,
-                         gpointer             user_data)
+static void
+add_listener (MetaPrefsChangedFunc func,
+              MetaPrefsChangesFunc changes_func,
+              gpointer             user_data)
 {
   MetaPrefsListener *l;
 
   l = g_new (MetaPrefsListener, 1);
   l->func = func;
+  l->changes_func = changes_func;
   l->data = user_data;
 
   listeners = g_list_prepend (listeners, l);
 }
 
-/**
- * meta_prefs_remove_listener: (skip)
- * @func: a #MetaPrefsChangedFunc
- * @user_data: data passed to the function
- *
- */
-void
-meta_prefs_remove_listener (MetaPrefsChangedFunc func,
-                            gpointer             user_data)
+static void
+remove_listener (MetaPrefsChangedFunc func,
+                 MetaPrefsChangesFunc changes_func,
+                 gpointer             user_data)
 {
   GList *tmp;
 
@@ -847,6 +845,7 @@ meta_prefs_remove_listener (MetaPrefsChangedFunc func,
       MetaPrefsListener *l = tmp->data;
 
       if (l->func == func &&
+          l->changes_func == changes_func &&
           l->data == user_data)
         {
           g_free (l);
@@ -861,56 +860,119 @@ meta_prefs_remove_listener (MetaPrefsChangedFunc func,
   meta_bug ("Did not find listener to remove\n");
 }
 
+/**
+ * meta_prefs_add_listener: (skip)
+ * @func: a #MetaPrefsChangedFunc
+ * @user_data: data passed to the function
+ *
+ */
+void
+meta_prefs_add_listener (MetaPrefsChangedFunc func,
+                         gpointer             user_data)
+{
+  add_listener (func, NULL, user_data);
+}
+
+/**
+ * meta_prefs_remove_listener: (skip)
+ * @func: a #MetaPrefsChangedFunc
+ * @user_data: data passed to the function
+ *
+ */
+void
+meta_prefs_remove_listener (MetaPrefsChangedFunc func,
+                            gpointer             user_data)
+{
+  remove_listener (func, NULL, user_data);
+}
+
+/**
+ * meta_prefs_add_changes_listener: (skip)
+ * @func: a #MetaPrefsChangesFunc
+ * @user_data: data passed to the function
+ *
+ * Like meta_prefs_add_listener(), but @func is called once with all
+ * the preferences that changed together, rather than once for each,
+ * so that it can do the work they have in common only once.
+ */
+void
+meta_prefs_add_changes_listener (MetaPrefsChangesFunc func,
+                                 gpointer             user_data)
+{
+  add_listener (NULL, func, user_data);
+}
+
+/**
+ * meta_prefs_remove_changes_listener: (skip)
+ * @func: a #MetaPrefsChangesFunc
+ * @user_data: data passed to the function
+ *
+ */
+void
+meta_prefs_remove_changes_listener (MetaPrefsChangesFunc func,
+                                    gpointer             user_data)
+{
+  remove_listener (NULL, func, user_data);
+}
+
 static void
-emit_changed (MetaPreference pref)
+emit_changes (MetaPrefsChanges emitted)
 {
   GList *tmp;
   GList *copy;
+  int pref;
 
-  meta_topic (META_DEBUG_PREFS, "Notifying listeners that pref %s changed\n",
-              meta_preference_to_string (pref));
-  
   copy = g_list_copy (listeners);
-  
-  tmp = copy;
 
-  while (tmp != NULL)
+  /* Listeners for single preferences get them in order... */
+  for (pref = 0; (emitted >> pref) != 0; pref++)
     {
-      MetaPrefsListener *l = tmp->data;
+      if (!META_PREFS_CHANGED (emitted, pref))
+        continue;
 
-      (* l->func) (pref, l->data);
+      meta_topic (META_DEBUG_PREFS, "Notifying listeners that pref %s changed\n",
+                  meta_preference_to_string (pref));
 
-      tmp = tmp->next;
+      for (tmp = copy; tmp != NULL; tmp = tmp->next)
+        {
+          MetaPrefsListener *l = tmp->data;
+
+          if (l->func)
+            (* l->func) (pref, l->data);
+        }
+    }
+
+  /* ...and the others get them all at once */
+  for (tmp = copy; tmp != NULL; tmp = tmp->next)
+    {
+      MetaPrefsListener *l = tmp->data;
+
+      if (l->changes_func)
+        (* l->changes_func) (emitted, l->data);
     }
 
   g_list_free (copy);
 }
 
+static void
+emit_changed (MetaPreference pref)
+{
+  emit_changes ((MetaPrefsChanges) 1 << pref);
+}
+
 static gboolean
 changed_idle_handler (gpointer data)
 {
-  GList *tmp;
-  GList *copy;
+  MetaPrefsChanges emitted;
 
   changed_idle = 0;
-  
-  copy = g_list_copy (changes); /* reentrancy paranoia */
 
-  g_list_free (changes);
-  changes = NULL;
-  
-  tmp = copy;
-  while (tmp != NULL)
-    {
-      MetaPreference pref = GPOINTER_TO_INT (tmp->data);
+  /* Anything queued by the listeners goes into the next batch */
+  emitted = changes;
+  changes = 0;
 
-      emit_changed (pref);
-      
-      tmp = tmp->next;
-    }
+  emit_changes (emitted);
 
-  g_list_free (copy);
-  
   return FALSE;
 }
 
@@ -920,8 +982,8 @@ queue_changed (MetaPreference pref)
   meta_topic (META_DEBUG_PREFS, "Queueing change of pref %s\n",
               meta_preference_to_string (pref));  
 
-  if (g_list_find (changes, GINT_TO_POINTER (pref)) == NULL)
-    changes = g_list_prepend (changes, GINT_TO_POINTER (pref));
+  if (!META_PREFS_CHANGED (changes, pref))
+    changes |= (MetaPrefsChanges) 1 << pref;
   else
     meta_topic (META_DEBUG_PREFS, "Change of pref %s was already pending\n",
                 meta_preference_to_string (pref));
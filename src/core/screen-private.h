@@ -80,6 +80,11 @@ struct _MetaScreen
   
   GList *workspaces;
 
+  /* Windows with on_all_workspaces set, in addition to being in
+   * their own workspace's window list.
+   */
+  GList *sticky_windows;
+
   MetaStack *stack;
   MetaStackTracker *stack_tracker;
 
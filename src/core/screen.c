@@ -62,8 +62,8 @@ static void update_num_workspaces  (MetaScreen *screen,
                                     guint32     timestamp);
 static void update_focus_mode      (MetaScreen *screen);
 static void set_workspace_names    (MetaScreen *screen);
-static void prefs_changed_callback (MetaPreference pref,
-                                    gpointer       data);
+static void prefs_changed_callback (MetaPrefsChanges changes,
+                                    gpointer         data);
 
 static void set_desktop_geometry_hint (MetaScreen *screen);
 static void set_desktop_viewport_hint (MetaScreen *screen);
@@ -705,6 +705,7 @@ meta_screen_new (MetaDisplay *display,
 
   screen->active_workspace = NULL;
   screen->workspaces = NULL;
+  screen->sticky_windows = NULL;
   screen->rows_of_workspaces = 1;
   screen->columns_of_workspaces = -1;
   screen->vertical_workspaces = FALSE;
@@ -772,7 +773,7 @@ meta_screen_new (MetaDisplay *display,
   screen->stack = meta_stack_new (screen);
   screen->stack_tracker = meta_stack_tracker_new (screen);
 
-  meta_prefs_add_listener (prefs_changed_callback, screen);
+  meta_prefs_add_changes_listener (prefs_changed_callback, screen);
 
 #ifdef HAVE_STARTUP_NOTIFICATION
   screen->sn_context =
@@ -822,7 +823,7 @@ meta_screen_free (MetaScreen *screen,
   
   meta_display_unmanage_windows_for_screen (display, screen, timestamp);
   
-  meta_prefs_remove_listener (prefs_changed_callback, screen);
+  meta_prefs_remove_changes_listener (prefs_changed_callback, screen);
   
   meta_screen_ungrab_keys (screen);
 
@@ -868,6 +869,8 @@ meta_screen_free (MetaScreen *screen,
   if (screen->monitor_infos)
     g_free (screen->monitor_infos);
 
+  g_list_free (screen->sticky_windows);
+
   if (screen->tile_preview_timeout_id)
     g_source_remove (screen->tile_preview_timeout_id);
 
@@ -932,13 +935,13 @@ meta_screen_for_x_screen (Screen *xscreen)
 }
 
 static void
-prefs_changed_callback (MetaPreference pref,
-                        gpointer       data)
+prefs_changed_callback (MetaPrefsChanges changes,
+                        gpointer         data)
 {
   MetaScreen *screen = data;
   
-  if ((pref == META_PREF_NUM_WORKSPACES ||
-       pref == META_PREF_DYNAMIC_WORKSPACES) &&
+  if ((META_PREFS_CHANGED (changes, META_PREF_NUM_WORKSPACES) ||
+       META_PREFS_CHANGED (changes, META_PREF_DYNAMIC_WORKSPACES)) &&
       !meta_prefs_get_dynamic_workspaces ())
     {
       /* GSettings doesn't provide timestamps, but luckily update_num_workspaces
@@ -948,11 +951,13 @@ prefs_changed_callback (MetaPreference pref,
         meta_display_get_current_time_roundtrip (screen->display);
       update_num_workspaces (screen, timestamp);
     }
-  else if (pref == META_PREF_FOCUS_MODE)
+
+  if (META_PREFS_CHANGED (changes, META_PREF_FOCUS_MODE))
     {
       update_focus_mode (screen);
     }
-  else if (pref == META_PREF_WORKSPACE_NAMES)
+
+  if (META_PREFS_CHANGED (changes, META_PREF_WORKSPACE_NAMES))
     {
       set_workspace_names (screen);
     }
@@ -1470,7 +1475,7 @@ meta_screen_tab_popup_create (MetaScreen      *screen,
 
       entries[i].key = (MetaTabEntryKey) window;
       entries[i].title = window->title;
-      entries[i].icon = g_object_ref (window->icon);
+      entries[i].icon = g_object_ref (meta_window_get_icon (window));
       entries[i].blank = FALSE;
       entries[i].hidden = !meta_window_showing_on_its_workspace (window);
       entries[i].demands_attention = window->wm_state_demands_attention;
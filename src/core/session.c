@@ -1057,6 +1057,70 @@ static GMarkupParser mutter_session_parser = {
 
 static GSList *window_info_list = NULL;
 
+/* The saved windows again, indexed by the fields that
+ * get_possible_matches() requires to be equal, so that matching a new
+ * window doesn't compare it against every saved window.
+ */
+static GHashTable *window_info_index = NULL;
+
+static char*
+session_info_key (const char *id,
+                  const char *res_class,
+                  const char *res_name,
+                  const char *role)
+{
+  /* Mark each field as present or missing, so a missing field never
+   * matches an empty one.
+   */
+  return g_strdup_printf ("%c%s\x1f%c%s\x1f%c%s\x1f%c%s",
+                          id ? '+' : '-', id ? id : "",
+                          res_class ? '+' : '-', res_class ? res_class : "",
+                          res_name ? '+' : '-', res_name ? res_name : "",
+                          role ? '+' : '-', role ? role : "");
+}
+
+static void
+index_session_info (MetaWindowSessionInfo *info)
+{
+  char *key;
+  GSList *bucket;
+
+  if (window_info_index == NULL)
+    window_info_index = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                               g_free, NULL);
+
+  key = session_info_key (info->id, info->res_class,
+                          info->res_name, info->role);
+
+  bucket = g_hash_table_lookup (window_info_index, key);
+  bucket = g_slist_prepend (bucket, info);
+  g_hash_table_replace (window_info_index, key, bucket);
+}
+
+static void
+unindex_session_info (MetaWindowSessionInfo *info)
+{
+  char *key;
+  GSList *bucket;
+
+  if (window_info_index == NULL)
+    return;
+
+  key = session_info_key (info->id, info->res_class,
+                          info->res_name, info->role);
+
+  bucket = g_hash_table_lookup (window_info_index, key);
+  bucket = g_slist_remove (bucket, info);
+
+  if (bucket)
+    g_hash_table_replace (window_info_index, key, bucket);
+  else
+    {
+      g_hash_table_remove (window_info_index, key);
+      g_free (key);
+    }
+}
+
 static char*
 load_state (const char *previous_save_file)
 {
@@ -1476,6 +1540,7 @@ end_element_handler    (GMarkupParseContext *context,
 
       window_info_list = g_slist_prepend (window_info_list,
                                           pd->info);
+      index_session_info (pd->info);
       
       meta_topic (META_DEBUG_SM, "Loaded window info from session with class: %s name: %s role: %s\n",
                   pd->info->res_class ? pd->info->res_class : "(none)",
@@ -1521,7 +1586,43 @@ get_possible_matches (MetaWindow *window)
   retval = NULL;
 
   ignore_client_id = g_getenv ("MUTTER_DEBUG_SM") != NULL;
-  
+
+  if (!ignore_client_id)
+    {
+      char *key;
+
+      if (window_info_index == NULL)
+        return NULL;
+
+      key = session_info_key (window->sm_client_id, window->res_class,
+                              window->res_name, window->role);
+
+      /* Buckets keep the order of window_info_list, so this gives
+       * the same order as the full scan below.
+       */
+      tmp = g_hash_table_lookup (window_info_index, key);
+      while (tmp != NULL)
+        {
+          MetaWindowSessionInfo *info;
+
+          info = tmp->data;
+
+          meta_topic (META_DEBUG_SM, "Window %s may match saved window with class: %s name: %s role: %s\n",
+                      window->desc,
+                      info->res_class ? info->res_class : "(none)",
+                      info->res_name ? info->res_name : "(none)",
+                      info->role ? info->role : "(none)");
+
+          retval = g_slist_prepend (retval, info);
+
+          tmp = tmp->next;
+        }
+
+      g_free (key);
+
+      return retval;
+    }
+
   tmp = window_info_list;
   while (tmp != NULL)
     {
@@ -1665,6 +1766,7 @@ meta_window_release_saved_state (const MetaWindowSessionInfo *info)
    * window.
    */
   window_info_list = g_slist_remove (window_info_list, info);
+  unindex_session_info ((MetaWindowSessionInfo*) info);
 
   session_info_free ((MetaWindowSessionInfo*) info);
 }
@@ -1470,6 +1470,40 @@ window_contains_point (MetaWindow *window,
   return POINT_IN_RECT (root_x, root_y, rect);
 }
 
+/* Returns the windows on @workspace, top of the stack first like
+ * stack->sorted, starting from the workspace's own windows instead of
+ * filtering the whole stack; most windows usually live on other
+ * workspaces.
+ */
+static GList*
+list_workspace_windows_sorted (MetaStack     *stack,
+                               MetaWorkspace *workspace)
+{
+  GList *windows;
+  GList *link;
+
+  stack_ensure_sorted (stack);
+
+  windows = meta_workspace_list_windows (workspace);
+
+  /* Windows that are being managed or unmanaged may be on the
+   * workspace without being in the stack.
+   */
+  link = windows;
+  while (link)
+    {
+      GList *next = link->next;
+      MetaWindow *window = link->data;
+
+      if (window->stack_position < 0)
+        windows = g_list_delete_link (windows, link);
+
+      link = next;
+    }
+
+  return g_list_sort (windows, (GCompareFunc) compare_window_position);
+}
+
 static MetaWindow*
 get_default_focus_window (MetaStack     *stack,
                           MetaWorkspace *workspace,
@@ -1488,6 +1522,7 @@ get_default_focus_window (MetaStack     *stack,
   MetaWindow *topmost_in_group;
   MetaWindow *topmost_overall;
   MetaGroup *not_this_one_group;
+  GList *windows;
   GList *link;
   
   transient_parent = NULL;
@@ -1498,10 +1533,19 @@ get_default_focus_window (MetaStack     *stack,
   else
     not_this_one_group = NULL;
 
-  stack_ensure_sorted (stack);
+  windows = NULL;
+  if (workspace)
+    {
+      windows = list_workspace_windows_sorted (stack, workspace);
+      link = windows;
+    }
+  else
+    {
+      stack_ensure_sorted (stack);
+      link = stack->sorted;
+    }
 
   /* top of this layer is at the front of the list */
-  link = stack->sorted;
       
   while (link)
     {
@@ -1511,9 +1555,7 @@ get_default_focus_window (MetaStack     *stack,
           window != not_this_one &&
           (window->unmaps_pending == 0) &&
           !window->minimized &&
-          (window->input || window->take_focus) &&
-          (workspace == NULL ||
-           meta_window_located_on_workspace (window, workspace)))
+          (window->input || window->take_focus))
         {
           if (not_this_one != NULL)
             {
@@ -1546,6 +1588,8 @@ get_default_focus_window (MetaStack     *stack,
       link = link->next;
     }
 
+  g_list_free (windows);
+
   if (transient_parent)
     return transient_parent;
   else if (topmost_in_group)
@@ -1582,6 +1626,9 @@ meta_stack_list_windows (MetaStack     *stack,
 {
   GList *workspace_windows = NULL;
   GList *link;
+
+  if (workspace)
+    return g_list_reverse (list_workspace_windows_sorted (stack, workspace));
   
   stack_ensure_sorted (stack); /* do adds/removes */
   
@@ -1591,8 +1638,7 @@ meta_stack_list_windows (MetaStack     *stack,
     {
       MetaWindow *window = link->data;
       
-      if (window &&
-          (workspace == NULL || meta_window_located_on_workspace (window, workspace)))
+      if (window)
         {
           workspace_windows = g_list_prepend (workspace_windows,
                                               window);
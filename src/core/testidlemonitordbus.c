@@ -0,0 +1,197 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/* Mutter idle monitor D-Bus notification testing program */
+
+/*
+ * Copyright 2013 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/* Fires watches through the D-Bus delivery code on a private bus,
+ * and counts the signals a client receives for them.
+ */
+
+#include <X11/Xlib.h>
+#include <gio/gio.h>
+#include <stdio.h>
+
+#include "meta-idle-monitor-private.h"
+
+#define OBJECT_PATH "/org/gnome/Mutter/IdleMonitor/Core"
+#define N_WATCHES 20
+
+typedef struct {
+  guint n_signals;
+  guint n_ids;
+} SignalCount;
+
+static void
+on_signal (GDBusConnection *connection,
+           const char      *sender_name,
+           const char      *object_path,
+           const char      *interface_name,
+           const char      *signal_name,
+           GVariant        *parameters,
+           gpointer         user_data)
+{
+  SignalCount *count = user_data;
+
+  count->n_signals++;
+
+  if (g_strcmp0 (signal_name, "WatchFired") == 0)
+    {
+      count->n_ids++;
+    }
+  else
+    {
+      GVariant *ids;
+
+      ids = g_variant_get_child_value (parameters, 0);
+      count->n_ids += g_variant_n_children (ids);
+      g_variant_unref (ids);
+    }
+}
+
+static GDBusConnection *
+connect_to_bus (GTestDBus *bus)
+{
+  GDBusConnection *connection;
+  GError *error = NULL;
+
+  connection = g_dbus_connection_new_for_address_sync (g_test_dbus_get_bus_address (bus),
+                                                       G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT |
+                                                       G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION,
+                                                       NULL, NULL, &error);
+  g_assert_no_error (error);
+
+  return connection;
+}
+
+/* Runs the main loop until count has seen n_ids ids */
+static void
+wait_for_ids (SignalCount *count,
+              guint        n_ids)
+{
+  gint64 deadline;
+
+  deadline = g_get_monotonic_time () + 5 * G_USEC_PER_SEC;
+
+  while (count->n_ids < n_ids)
+    {
+      g_assert (g_get_monotonic_time () < deadline);
+      g_main_context_iteration (NULL, TRUE);
+    }
+}
+
+static void
+sleep_in_main_loop (guint msec)
+{
+  gint64 end;
+
+  end = g_get_monotonic_time () + msec * 1000;
+  while (g_get_monotonic_time () < end)
+    g_main_context_iteration (NULL, FALSE);
+}
+
+static SignalCount
+run_scenario (GDBusConnection *service,
+              GDBusConnection *listener,
+              gboolean         batched,
+              guint            user_active_interval)
+{
+  MetaIdleMonitorDBusClient *client;
+  SignalCount count = { 0, 0 };
+  guint subscription;
+  guint i;
+
+  subscription = g_dbus_connection_signal_subscribe (listener,
+                                                     NULL,
+                                                     "org.gnome.Mutter.IdleMonitor",
+                                                     NULL,
+                                                     OBJECT_PATH,
+                                                     NULL,
+                                                     G_DBUS_SIGNAL_FLAGS_NONE,
+                                                     on_signal, &count, NULL);
+
+  client = meta_idle_monitor_dbus_client_new (service,
+                                              g_dbus_connection_get_unique_name (listener),
+                                              OBJECT_PATH);
+  meta_idle_monitor_dbus_client_set_batched (client, batched);
+  meta_idle_monitor_dbus_client_set_user_active_interval (client, user_active_interval);
+
+  if (user_active_interval == 0)
+    {
+      /* All the idle watches going off at once */
+      for (i = 0; i < N_WATCHES; i++)
+        meta_idle_monitor_dbus_client_watch_fired (client, i + 1, FALSE);
+    }
+  else
+    {
+      /* The user becoming active over and over, faster than the
+       * rate limit, with the client adding its watch back each time
+       */
+      for (i = 0; i < N_WATCHES; i++)
+        {
+          meta_idle_monitor_dbus_client_watch_fired (client, i + 1, TRUE);
+          sleep_in_main_loop (5);
+        }
+    }
+
+  wait_for_ids (&count, N_WATCHES);
+
+  meta_idle_monitor_dbus_client_unref (client);
+  g_dbus_connection_signal_unsubscribe (listener, subscription);
+
+  return count;
+}
+
+int
+main (int argc, char **argv)
+{
+  GTestDBus *bus;
+  GDBusConnection *service, *listener;
+  SignalCount count;
+
+  bus = g_test_dbus_new (G_TEST_DBUS_NONE);
+  g_test_dbus_up (bus);
+
+  service = connect_to_bus (bus);
+  listener = connect_to_bus (bus);
+
+  count = run_scenario (service, listener, FALSE, 0);
+  printf ("unbatched:             %2u signals for %u watches\n", count.n_signals, count.n_ids);
+  g_assert_cmpuint (count.n_signals, ==, N_WATCHES);
+
+  count = run_scenario (service, listener, TRUE, 0);
+  printf ("batched:               %2u signals for %u watches\n", count.n_signals, count.n_ids);
+  g_assert_cmpuint (count.n_signals, ==, 1);
+
+  /* 20 watches 5ms apart against a 40ms limit: the first is reported
+     right away, the others in batches at most every 40ms */
+  count = run_scenario (service, listener, TRUE, 40);
+  printf ("batched, rate limited: %2u signals for %u watches\n", count.n_signals, count.n_ids);
+  g_assert_cmpuint (count.n_signals, <, N_WATCHES / 2);
+
+  g_object_unref (service);
+  g_object_unref (listener);
+
+  g_test_dbus_down (bus);
+  g_object_unref (bus);
+
+  printf ("All tests passed.\n");
+  return 0;
+}
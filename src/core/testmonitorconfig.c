@@ -0,0 +1,133 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/* Mutter CRTC assignment testing program */
+
+/*
+ * Copyright (C) 2013 Red Hat Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/* Runs the default configuration logic against the synthetic
+ * topologies of the dummy monitor backend, checks the resulting
+ * CRTC assignment and reports how long it took.
+ *
+ * Usage: testmonitorconfig [ITERATIONS]
+ */
+
+#include "monitor-private.h"
+#include <glib.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+typedef struct {
+  const char *topology;
+  gboolean    satisfiable;
+} Topology;
+
+static const Topology topologies[] = {
+  { "2", TRUE },
+  { "8", TRUE },
+  { "8:7", FALSE },
+  { "8:4", FALSE },
+  { "12:12", TRUE },
+  { "12:11", FALSE },
+};
+
+static void
+check_assignment (MetaMonitorManager *manager,
+                  const Topology     *topology)
+{
+  unsigned int i, j;
+
+  /* Output 0 started out on CRTC 0, and should stay there */
+  g_assert (manager->outputs[0].crtc == &manager->crtcs[0]);
+
+  if (!topology->satisfiable)
+    {
+      /* The default configuration can't be applied, so the
+       * initial one is left alone
+       */
+      for (i = 1; i < manager->n_outputs; i++)
+        g_assert (manager->outputs[i].crtc == NULL);
+
+      return;
+    }
+
+  for (i = 0; i < manager->n_outputs; i++)
+    {
+      MetaOutput *output = &manager->outputs[i];
+
+      g_assert (output->crtc != NULL);
+      g_assert (output->crtc->current_mode == output->preferred_mode);
+
+      for (j = 0; j < i; j++)
+        g_assert (manager->outputs[j].crtc != output->crtc);
+    }
+}
+
+static void
+run_topology (const Topology *topology,
+              int             iterations)
+{
+  MetaMonitorManager *manager;
+  GTimer *timer;
+  int i;
+
+  g_setenv ("META_DEBUG_MULTIMONITOR_OUTPUTS", topology->topology, TRUE);
+
+  manager = g_object_new (META_TYPE_MONITOR_MANAGER, NULL);
+  check_assignment (manager, topology);
+
+  timer = g_timer_new ();
+
+  for (i = 0; i < iterations; i++)
+    {
+      meta_monitor_config_make_default (manager->config, manager);
+      check_assignment (manager, topology);
+    }
+
+  g_timer_stop (timer);
+
+  printf ("%-8s %-14s %8.3f ms per configuration\n",
+          topology->topology,
+          topology->satisfiable ? "satisfiable" : "unsatisfiable",
+          g_timer_elapsed (timer, NULL) * 1000.0 / iterations);
+
+  g_timer_destroy (timer);
+  g_object_unref (manager);
+}
+
+int
+main (int argc, char **argv)
+{
+  unsigned int i;
+  int iterations;
+
+  iterations = (argc > 1) ? atoi (argv[1]) : 100;
+  if (iterations <= 0)
+    iterations = 100;
+
+  /* Always the dummy backend, and never a stored configuration */
+  g_setenv ("META_DEBUG_MULTIMONITOR", "dummy", TRUE);
+  g_setenv ("MUTTER_MONITOR_FILENAME", "testmonitorconfig-nonexistent.xml", TRUE);
+
+  for (i = 0; i < G_N_ELEMENTS (topologies); i++)
+    run_topology (&topologies[i], iterations);
+
+  printf ("All tests passed.\n");
+  return 0;
+}
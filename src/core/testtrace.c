@@ -0,0 +1,153 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/* Mutter trace buffer testing program */
+
+/*
+ * Copyright (C) 2013 Red Hat Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/* Checks that messages recorded into the trace buffer come out the
+ * way g_strdup_printf() would have formatted them, and reports what a
+ * meta_topic() call costs.
+ */
+
+#include "util-private.h"
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define N_CALLS 1000000
+
+#define CHECK_FORMAT(format, ...)                                       \
+  G_STMT_START {                                                        \
+    char *expected = g_strdup_printf (format, __VA_ARGS__);            \
+    char *traced;                                                       \
+                                                                        \
+    meta_clear_trace ();                                                \
+    meta_topic (META_DEBUG_FOCUS, format, __VA_ARGS__);                 \
+    traced = meta_get_trace_messages ();                                \
+    g_assert_cmpstr (traced, ==, expected);                             \
+    g_free (traced);                                                    \
+    g_free (expected);                                                  \
+  } G_STMT_END
+
+static void
+test_formats (void)
+{
+  char long_string[300];
+
+  memset (long_string, 'x', sizeof (long_string) - 1);
+  long_string[sizeof (long_string) - 1] = '\0';
+
+  CHECK_FORMAT ("window %s focused at %u\n", "0x1400003 (Terminal)", 12345u);
+  CHECK_FORMAT ("%d %i %5d %-5d| %+d %05d\n", -1, 2, 3, 4, 5, -6);
+  CHECK_FORMAT ("%hd %hhu %ld %lu %lld %llx\n",
+                (short) -7, (unsigned char) 200, -8L, 9UL, -10LL, 0xdeadbeefcafeULL);
+  CHECK_FORMAT ("%" G_GINT64_FORMAT " %" G_GSIZE_FORMAT " %zd\n",
+                G_MININT64, (gsize) 11, (gssize) -12);
+  CHECK_FORMAT ("0x%lx %#x %o %X %c\n", 0x1400003UL, 255u, 8u, 0xabcu, 'q');
+  CHECK_FORMAT ("%g %f %.2f %10.3e %Lg\n", 0.5, 1.25, 3.14159, -2e10, (long double) 7.5);
+  CHECK_FORMAT ("%*d|%-*d|%.*s|%.*f\n", 6, 42, 6, 42, 3, "abcdef", -1, 2.5);
+  CHECK_FORMAT ("%s %s 100%% %p\n", "a", (char *) NULL, (void *) 0x1234);
+  CHECK_FORMAT ("%s\n", "");
+
+  /* Strings past the space in a record are cut short */
+  {
+    char *traced;
+
+    meta_clear_trace ();
+    meta_topic (META_DEBUG_FOCUS, "%s|%s\n", long_string, "after");
+    traced = meta_get_trace_messages ();
+    g_assert (g_str_has_prefix (traced, "xxxx"));
+    g_assert (strlen (traced) < strlen (long_string));
+    g_free (traced);
+  }
+
+  /* Arguments past the ones that fit are left in the format */
+  {
+    char *traced;
+
+    meta_clear_trace ();
+    meta_topic (META_DEBUG_FOCUS, "%d %d %d %d %d %d %d %d %d %d\n",
+                1, 2, 3, 4, 5, 6, 7, 8, 9, 10);
+    traced = meta_get_trace_messages ();
+    g_assert_cmpstr (traced, ==, "1 2 3 4 5 6 7 8 %d %d\n");
+    g_free (traced);
+  }
+}
+
+static void
+test_wraparound (void)
+{
+  char *traced, **lines;
+  int i, n;
+
+  meta_clear_trace ();
+
+  for (i = 0; i < 20000; i++)
+    meta_topic (META_DEBUG_FOCUS, "%d\n", i);
+
+  /* Only the newest messages are kept, in order */
+  traced = meta_get_trace_messages ();
+  lines = g_strsplit (traced, "\n", -1);
+  n = g_strv_length (lines) - 1;
+
+  g_assert_cmpint (n, >, 0);
+  g_assert_cmpint (n, <, 20000);
+  for (i = 0; i < n; i++)
+    g_assert_cmpint (atoi (lines[i]), ==, 20000 - n + i);
+
+  g_strfreev (lines);
+  g_free (traced);
+}
+
+static void
+time_calls (void)
+{
+  GTimer *timer;
+  int i;
+
+  timer = g_timer_new ();
+  for (i = 0; i < N_CALLS; i++)
+    meta_topic (META_DEBUG_FOCUS, "window %s moved to %d,%d\n", "0x1400003", i, -i);
+  printf ("enabled topic:  %6.1f ns per call\n",
+          g_timer_elapsed (timer, NULL) * 1e9 / N_CALLS);
+
+  g_timer_start (timer);
+  for (i = 0; i < N_CALLS; i++)
+    meta_topic (META_DEBUG_STACK, "window %s moved to %d,%d\n", "0x1400003", i, -i);
+  printf ("disabled topic: %6.1f ns per call\n",
+          g_timer_elapsed (timer, NULL) * 1e9 / N_CALLS);
+
+  g_timer_destroy (timer);
+}
+
+int
+main (int argc, char **argv)
+{
+  meta_add_verbose_topic (META_DEBUG_FOCUS);
+  meta_set_tracing (TRUE);
+
+  test_formats ();
+  test_wraparound ();
+  time_calls ();
+
+  printf ("All tests passed.\n");
+  return 0;
+}
@@ -33,6 +33,7 @@
 #include <meta/common.h>
 #include <meta/util.h>
 #include <meta/main.h>
+#include "util-private.h"
 
 #include <clutter/clutter.h> /* For clutter_threads_add_repaint_func() */
 
@@ -341,6 +342,582 @@ topic_name (MetaDebugTopic topic)
   return "WM";
 }
 
+/* Tracing: instead of being formatted and written out as they
+ * happen, messages go into a ring buffer as the format string and the
+ * raw arguments, and are only formatted when the buffer is dumped.
+ * The format strings are assumed to be static, as they are for all
+ * the meta_topic() and meta_verbose() calls; string arguments are
+ * copied.
+ */
+
+#define TRACE_N_RECORDS    8192 /* must be a power of two */
+#define TRACE_MAX_ARGS     8
+#define TRACE_STRING_SPACE 128
+
+typedef union
+{
+  gint64 i;
+  double d;
+  gconstpointer p;
+} MetaTraceArg;
+
+typedef struct
+{
+  /* The index of the record plus one once it's complete, 0 while
+   * it's being written
+   */
+  volatile gint seq;
+  MetaDebugTopic topic;
+  gint64 time;
+  const char *format;
+  guint8 n_args;
+  guint8 string_len;
+  MetaTraceArg args[TRACE_MAX_ARGS];
+  char strings[TRACE_STRING_SPACE];
+} MetaTraceRecord;
+
+typedef enum
+{
+  TRACE_LENGTH_NONE,
+  TRACE_LENGTH_CHAR,
+  TRACE_LENGTH_SHORT,
+  TRACE_LENGTH_LONG,
+  TRACE_LENGTH_LONG_LONG,
+  TRACE_LENGTH_SIZE,
+  TRACE_LENGTH_LONG_DOUBLE
+} MetaTraceLength;
+
+/* One conversion specification, say "%-*.3lx" */
+typedef struct
+{
+  const char *start;
+  const char *flags_end;
+  gboolean star_width;
+  gboolean star_precision;
+  MetaTraceLength length;
+  char conversion;
+} MetaTraceSpec;
+
+static MetaTraceRecord *trace_records = NULL;
+static volatile gint trace_next = 0;
+static gboolean tracing = FALSE;
+
+/* Parses the conversion specification at p, which points to a '%'
+ * that isn't the first of "%%". Returns the end of it, or NULL if it's
+ * something the trace doesn't handle, such as positional arguments.
+ */
+static const char *
+parse_trace_spec (const char    *p,
+                  MetaTraceSpec *spec)
+{
+  spec->start = p++;
+  spec->star_width = FALSE;
+  spec->star_precision = FALSE;
+  spec->length = TRACE_LENGTH_NONE;
+
+  while (*p && strchr ("-+ #0'", *p))
+    p++;
+  spec->flags_end = p;
+
+  if (*p == '*')
+    {
+      spec->star_width = TRUE;
+      p++;
+    }
+  else
+    {
+      while (g_ascii_isdigit (*p))
+        p++;
+    }
+
+  if (*p == '$')
+    return NULL;
+
+  if (*p == '.')
+    {
+      p++;
+      if (*p == '*')
+        {
+          spec->star_precision = TRUE;
+          p++;
+        }
+      else
+        {
+          while (g_ascii_isdigit (*p))
+            p++;
+        }
+    }
+
+  switch (*p)
+    {
+    case 'h':
+      p++;
+      if (*p == 'h')
+        {
+          spec->length = TRACE_LENGTH_CHAR;
+          p++;
+        }
+      else
+        spec->length = TRACE_LENGTH_SHORT;
+      break;
+    case 'l':
+      p++;
+      if (*p == 'l')
+        {
+          spec->length = TRACE_LENGTH_LONG_LONG;
+          p++;
+        }
+      else
+        spec->length = TRACE_LENGTH_LONG;
+      break;
+    case 'q':
+    case 'j':
+      spec->length = TRACE_LENGTH_LONG_LONG;
+      p++;
+      break;
+    case 'z':
+    case 't':
+      spec->length = TRACE_LENGTH_SIZE;
+      p++;
+      break;
+    case 'L':
+      spec->length = TRACE_LENGTH_LONG_DOUBLE;
+      p++;
+      break;
+    }
+
+  switch (*p)
+    {
+    case 'd': case 'i':
+    case 'o': case 'u': case 'x': case 'X':
+    case 'c':
+    case 'e': case 'E': case 'f': case 'F':
+    case 'g': case 'G': case 'a': case 'A':
+    case 'p':
+      break;
+    case 's':
+      /* Wide strings aren't handled */
+      if (spec->length != TRACE_LENGTH_NONE)
+        return NULL;
+      break;
+    default:
+      return NULL;
+    }
+
+  spec->conversion = *p;
+
+  return p + 1;
+}
+
+static gint64
+trace_read_signed (MetaTraceLength length,
+                   va_list        *args)
+{
+  switch (length)
+    {
+    case TRACE_LENGTH_CHAR:
+      return (signed char) va_arg (*args, int);
+    case TRACE_LENGTH_SHORT:
+      return (short) va_arg (*args, int);
+    case TRACE_LENGTH_LONG:
+      return va_arg (*args, long);
+    case TRACE_LENGTH_LONG_LONG:
+      return va_arg (*args, long long);
+    case TRACE_LENGTH_SIZE:
+      return va_arg (*args, gssize);
+    default:
+      return va_arg (*args, int);
+    }
+}
+
+static guint64
+trace_read_unsigned (MetaTraceLength length,
+                     va_list        *args)
+{
+  switch (length)
+    {
+    case TRACE_LENGTH_CHAR:
+      return (unsigned char) va_arg (*args, unsigned int);
+    case TRACE_LENGTH_SHORT:
+      return (unsigned short) va_arg (*args, unsigned int);
+    case TRACE_LENGTH_LONG:
+      return va_arg (*args, unsigned long);
+    case TRACE_LENGTH_LONG_LONG:
+      return va_arg (*args, unsigned long long);
+    case TRACE_LENGTH_SIZE:
+      return va_arg (*args, gsize);
+    default:
+      return va_arg (*args, unsigned int);
+    }
+}
+
+/* Copies a string argument into the record, and returns its offset
+ * there, or -1 for NULL.
+ */
+static gint64
+trace_copy_string (MetaTraceRecord *record,
+                   const char      *str)
+{
+  guint offset = record->string_len;
+  guint space = TRACE_STRING_SPACE - offset;
+  guint len;
+
+  if (str == NULL)
+    return -1;
+
+  len = strnlen (str, space - 1);
+  memcpy (record->strings + offset, str, len);
+  record->strings[offset + len] = '\0';
+  record->string_len = offset + len + 1;
+
+  return offset;
+}
+
+static void
+trace_record_valist (MetaDebugTopic topic,
+                     const char    *format,
+                     va_list        args)
+{
+  MetaTraceRecord *record;
+  MetaTraceSpec spec;
+  const char *p;
+  guint index;
+  va_list copy;
+
+  index = (guint) g_atomic_int_add (&trace_next, 1);
+  record = &trace_records[index & (TRACE_N_RECORDS - 1)];
+
+  g_atomic_int_set (&record->seq, 0);
+
+  record->topic = topic;
+  record->time = g_get_monotonic_time ();
+  record->format = format;
+  record->n_args = 0;
+  record->string_len = 0;
+
+  G_VA_COPY (copy, args);
+
+  for (p = strchr (format, '%'); p; p = strchr (p, '%'))
+    {
+      const char *end;
+      guint n_needed;
+
+      if (p[1] == '%')
+        {
+          p += 2;
+          continue;
+        }
+
+      end = parse_trace_spec (p, &spec);
+
+      n_needed = 1 + spec.star_width + spec.star_precision;
+      if (end == NULL ||
+          record->n_args + n_needed > TRACE_MAX_ARGS ||
+          (spec.conversion == 's' &&
+           record->string_len >= TRACE_STRING_SPACE))
+        break;
+
+      if (spec.star_width)
+        record->args[record->n_args++].i = va_arg (copy, int);
+      if (spec.star_precision)
+        record->args[record->n_args++].i = va_arg (copy, int);
+
+      switch (spec.conversion)
+        {
+        case 'd': case 'i':
+          record->args[record->n_args].i = trace_read_signed (spec.length, &copy);
+          break;
+        case 'o': case 'u': case 'x': case 'X':
+          record->args[record->n_args].i = trace_read_unsigned (spec.length, &copy);
+          break;
+        case 'c':
+          record->args[record->n_args].i = va_arg (copy, int);
+          break;
+        case 's':
+          record->args[record->n_args].i = trace_copy_string (record,
+                                                              va_arg (copy, const char *));
+          break;
+        case 'p':
+          record->args[record->n_args].p = va_arg (copy, gconstpointer);
+          break;
+        default:
+          if (spec.length == TRACE_LENGTH_LONG_DOUBLE)
+            record->args[record->n_args].d = va_arg (copy, long double);
+          else
+            record->args[record->n_args].d = va_arg (copy, double);
+          break;
+        }
+      record->n_args++;
+
+      p = end;
+    }
+
+  va_end (copy);
+
+  g_atomic_int_set (&record->seq, (gint) (index + 1));
+}
+
+/* Formats one argument of a record, following spec but with the
+ * length modifier replaced to match how the argument was stored.
+ */
+static void
+trace_format_arg (GString             *out,
+                  const MetaTraceSpec *spec,
+                  const MetaTraceArg  *args,
+                  const char          *strings)
+{
+  GString *conv;
+  const char *p;
+  const MetaTraceArg *value;
+
+  conv = g_string_new_len (spec->start, spec->flags_end - spec->start);
+  p = spec->flags_end;
+
+  if (spec->star_width)
+    {
+      g_string_append_printf (conv, "%d", (int) (args++)->i);
+      p++;
+    }
+  else
+    {
+      while (g_ascii_isdigit (*p))
+        g_string_append_c (conv, *p++);
+    }
+
+  if (*p == '.')
+    {
+      p++;
+      if (spec->star_precision)
+        {
+          int precision = (int) (args++)->i;
+
+          /* A negative precision is taken as if it were omitted */
+          if (precision >= 0)
+            g_string_append_printf (conv, ".%d", precision);
+          p++;
+        }
+      else
+        {
+          g_string_append_c (conv, '.');
+          while (g_ascii_isdigit (*p))
+            g_string_append_c (conv, *p++);
+        }
+    }
+
+  value = args;
+
+  switch (spec->conversion)
+    {
+    case 'd': case 'i':
+      g_string_append (conv, "ll");
+      g_string_append_c (conv, spec->conversion);
+      g_string_append_printf (out, conv->str, (long long) value->i);
+      break;
+    case 'o': case 'u': case 'x': case 'X':
+      g_string_append (conv, "ll");
+      g_string_append_c (conv, spec->conversion);
+      g_string_append_printf (out, conv->str, (unsigned long long) value->i);
+      break;
+    case 'c':
+      g_string_append_c (conv, 'c');
+      g_string_append_printf (out, conv->str, (int) value->i);
+      break;
+    case 's':
+      g_string_append_c (conv, 's');
+      g_string_append_printf (out, conv->str,
+                              value->i < 0 ? "(null)" : strings + value->i);
+      break;
+    case 'p':
+      g_string_append_c (conv, 'p');
+      g_string_append_printf (out, conv->str, value->p);
+      break;
+    default:
+      g_string_append_c (conv, spec->conversion);
+      g_string_append_printf (out, conv->str, value->d);
+      break;
+    }
+
+  g_string_free (conv, TRUE);
+}
+
+static void
+trace_format_record (GString               *out,
+                     const MetaTraceRecord *record)
+{
+  MetaTraceSpec spec;
+  const char *p, *start;
+  guint n_args = 0;
+
+  start = record->format;
+
+  for (p = strchr (start, '%'); p; p = strchr (p, '%'))
+    {
+      const char *end;
+      guint n_needed;
+
+      if (p[1] == '%')
+        {
+          g_string_append_len (out, start, p + 1 - start);
+          p += 2;
+          start = p;
+          continue;
+        }
+
+      end = parse_trace_spec (p, &spec);
+      if (end == NULL)
+        break;
+
+      n_needed = 1 + spec.star_width + spec.star_precision;
+      if (n_args + n_needed > record->n_args)
+        break;
+
+      g_string_append_len (out, start, p - start);
+      trace_format_arg (out, &spec, record->args + n_args, record->strings);
+      n_args += n_needed;
+
+      p = end;
+      start = p;
+    }
+
+  /* Whatever couldn't be recorded is left as it was in the format */
+  g_string_append (out, start);
+}
+
+/* Calls func for each complete record in the buffer, oldest first.
+ * Records that are overwritten while they are formatted are left out.
+ */
+static void
+trace_foreach (void     (*func) (const MetaTraceRecord *record,
+                                 const char            *message,
+                                 gpointer               data),
+               gpointer   data)
+{
+  GString *message;
+  guint next, first, i;
+
+  if (trace_records == NULL)
+    return;
+
+  message = g_string_new (NULL);
+
+  next = (guint) g_atomic_int_get (&trace_next);
+  first = next > TRACE_N_RECORDS ? next - TRACE_N_RECORDS : 0;
+
+  for (i = first; i != next; i++)
+    {
+      const MetaTraceRecord *record = &trace_records[i & (TRACE_N_RECORDS - 1)];
+      MetaTraceRecord copy;
+
+      if ((guint) g_atomic_int_get (&record->seq) != i + 1)
+        continue;
+
+      copy = *record;
+
+      if ((guint) g_atomic_int_get (&record->seq) != i + 1)
+        continue;
+
+      g_string_truncate (message, 0);
+      trace_format_record (message, &copy);
+      func (&copy, message->str, data);
+    }
+
+  g_string_free (message, TRUE);
+}
+
+static void
+append_trace_message (const MetaTraceRecord *record,
+                      const char            *message,
+                      gpointer               data)
+{
+  g_string_append (data, message);
+}
+
+static void
+write_trace_message (const MetaTraceRecord *record,
+                     const char            *message,
+                     gpointer               data)
+{
+  FILE *out = data;
+
+  fprintf (out, "%s: [%" G_GINT64_FORMAT ".%06d] ",
+           topic_name (record->topic),
+           record->time / G_USEC_PER_SEC,
+           (int) (record->time % G_USEC_PER_SEC));
+  utf8_fputs (message, out);
+}
+
+/**
+ * meta_set_tracing: (skip)
+ * @setting: whether to trace
+ *
+ * Switches logging for the enabled topics between writing each message
+ * out right away and recording them into a ring buffer, which is only
+ * written out by meta_dump_trace(). The buffer keeps the last few
+ * thousand messages.
+ */
+void
+meta_set_tracing (gboolean setting)
+{
+  if (setting && trace_records == NULL)
+    trace_records = g_new0 (MetaTraceRecord, TRACE_N_RECORDS);
+
+  tracing = setting;
+}
+
+/**
+ * meta_dump_trace: (skip)
+ *
+ * Writes the messages in the trace buffer to the log, oldest first,
+ * and empties the buffer.
+ */
+void
+meta_dump_trace (void)
+{
+  FILE *out;
+
+  ensure_logfile ();
+  out = logfile ? logfile : stderr;
+
+  trace_foreach (write_trace_message, out);
+  fflush (out);
+
+  meta_clear_trace ();
+}
+
+/**
+ * meta_clear_trace: (skip)
+ *
+ * Empties the trace buffer.
+ */
+void
+meta_clear_trace (void)
+{
+  guint i;
+
+  if (trace_records == NULL)
+    return;
+
+  for (i = 0; i < TRACE_N_RECORDS; i++)
+    g_atomic_int_set (&trace_records[i].seq, 0);
+}
+
+/**
+ * meta_get_trace_messages: (skip)
+ *
+ * Returns: the messages in the trace buffer, oldest first, formatted
+ *  and concatenated. Free with g_free().
+ */
+char *
+meta_get_trace_messages (void)
+{
+  GString *out;
+
+  out = g_string_new (NULL);
+  trace_foreach (append_trace_message, out);
+
+  return g_string_free (out, FALSE);
+}
+
 static int sync_count = 0;
 
 static void
@@ -351,13 +928,19 @@ meta_topic_real_valist (MetaDebugTopic topic,
   gchar *str;
   FILE *out;
 
-  g_return_if_fail (format != NULL);
-
   if (verbose_topics == 0
       || (topic == META_DEBUG_VERBOSE && verbose_topics != META_DEBUG_VERBOSE)
       || (!(verbose_topics & topic)))
     return;
 
+  g_return_if_fail (format != NULL);
+
+  if (tracing)
+    {
+      trace_record_valist (topic, format, args);
+      return;
+    }
+
   str = g_strdup_vprintf (format, args);
 
   out = logfile ? logfile : stderr;
@@ -389,6 +972,29 @@ meta_topic_real (MetaDebugTopic topic,
   meta_topic_real_valist (topic, format, args);
   va_end (args);
 }
+#else /* !WITH_VERBOSE_MODE */
+void
+meta_set_tracing (gboolean setting)
+{
+  if (setting)
+    meta_fatal (_("Mutter was compiled without support for verbose mode\n"));
+}
+
+void
+meta_dump_trace (void)
+{
+}
+
+void
+meta_clear_trace (void)
+{
+}
+
+char *
+meta_get_trace_messages (void)
+{
+  return g_strdup ("");
+}
 #endif /* WITH_VERBOSE_MODE */
 
 void
@@ -739,7 +1345,16 @@ meta_show_dialog (const char *type,
 
 static guint last_later_id = 0;
 
-typedef struct
+typedef struct _MetaLater MetaLater;
+typedef struct _MetaLaterQueue MetaLaterQueue;
+
+struct _MetaLaterQueue
+{
+  MetaLater *head;
+  MetaLater *tail;
+};
+
+struct _MetaLater
 {
   guint id;
   guint ref_count;
@@ -749,15 +1364,65 @@ typedef struct
   GDestroyNotify notify;
   int source;
   gboolean run_once;
-} MetaLater;
 
-static GSList *laters = NULL;
+  /* The queue the later is linked into, or NULL once it's removed */
+  MetaLaterQueue *queue;
+  MetaLater *prev;
+  MetaLater *next;
+};
+
+#define N_LATER_TYPES (META_LATER_IDLE + 1)
+
+/* One queue per type, newest first. Laters of the same type run in
+ * that order, and types run in the order of the enumeration; this is
+ * the order the single sorted list used to give them, and the resize
+ * and showing code has come to depend on it.
+ */
+static MetaLaterQueue later_queues[N_LATER_TYPES];
+/* id => MetaLater, for meta_later_remove() */
+static GHashTable *later_ids = NULL;
+
+/* Freed laters are kept around and reused, since most of them only
+ * live for a frame, and a busy frame can add a lot of them.
+ */
+#define LATER_POOL_MAX 64
+static MetaLater *later_pool = NULL;
+static guint later_pool_size = 0;
+
+/* Time spent in each type of later since the last frame, in
+ * microseconds, and how many were run. Only kept with the
+ * COMPOSITOR debug topic enabled.
+ */
+static gint64 later_usec[N_LATER_TYPES];
+static guint later_runs[N_LATER_TYPES];
+
 /* This is a dummy timeline used to get the Clutter master clock running */
 static ClutterTimeline *later_timeline;
 static guint later_repaint_func = 0;
 
 static void ensure_later_repaint_func (void);
 
+static MetaLater *
+alloc_later (void)
+{
+  MetaLater *later;
+
+  if (later_pool)
+    {
+      later = later_pool;
+      later_pool = later->next;
+      later_pool_size--;
+
+      memset (later, 0, sizeof (MetaLater));
+    }
+  else
+    {
+      later = g_slice_new0 (MetaLater);
+    }
+
+  return later;
+}
+
 static void
 unref_later (MetaLater *later)
 {
@@ -768,10 +1433,70 @@ unref_later (MetaLater *later)
           later->notify (later->data);
           later->notify = NULL;
         }
-      g_slice_free (MetaLater, later);
+
+      if (later_pool_size < LATER_POOL_MAX)
+        {
+          later->next = later_pool;
+          later_pool = later;
+          later_pool_size++;
+        }
+      else
+        {
+          g_slice_free (MetaLater, later);
+        }
     }
 }
 
+static void
+later_queue_push (MetaLaterQueue *queue,
+                  MetaLater      *later)
+{
+  later->queue = queue;
+  later->prev = queue->tail;
+  later->next = NULL;
+
+  if (queue->tail)
+    queue->tail->next = later;
+  else
+    queue->head = later;
+  queue->tail = later;
+}
+
+static void
+later_queue_push_head (MetaLaterQueue *queue,
+                       MetaLater      *later)
+{
+  later->queue = queue;
+  later->prev = NULL;
+  later->next = queue->head;
+
+  if (queue->head)
+    queue->head->prev = later;
+  else
+    queue->tail = later;
+  queue->head = later;
+}
+
+static void
+later_queue_unlink (MetaLater *later)
+{
+  MetaLaterQueue *queue = later->queue;
+
+  if (later->prev)
+    later->prev->next = later->next;
+  else
+    queue->head = later->next;
+
+  if (later->next)
+    later->next->prev = later->prev;
+  else
+    queue->tail = later->prev;
+
+  later->queue = NULL;
+  later->prev = NULL;
+  later->next = NULL;
+}
+
 static void
 destroy_later (MetaLater *later)
 {
@@ -784,55 +1509,154 @@ destroy_later (MetaLater *later)
   unref_later (later);
 }
 
-/* Used to sort the list of laters with the highest priority
- * functions first.
+static gboolean
+later_timing_enabled (void)
+{
+#ifdef WITH_VERBOSE_MODE
+  return (verbose_topics & META_DEBUG_COMPOSITOR) != 0;
+#else
+  return FALSE;
+#endif
+}
+
+static const char *
+later_type_name (MetaLaterType when)
+{
+  switch (when)
+    {
+    case META_LATER_RESIZE:
+      return "resize";
+    case META_LATER_CALC_SHOWING:
+      return "calc-showing";
+    case META_LATER_CHECK_FULLSCREEN:
+      return "check-fullscreen";
+    case META_LATER_SYNC_STACK:
+      return "sync-stack";
+    case META_LATER_BEFORE_REDRAW:
+      return "before-redraw";
+    case META_LATER_IDLE:
+      return "idle";
+    }
+
+  return "unknown";
+}
+
+/* Logs the time spent in laters since the last frame, including the
+ * ones run from idles, and starts over.
  */
-static int
-compare_laters (gconstpointer a,
-                gconstpointer b)
+static void
+report_later_timings (void)
 {
-  return ((const MetaLater *)a)->when - ((const MetaLater *)b)->when;
+  GString *report;
+  gint64 total_usec = 0;
+  int i;
+
+  report = g_string_new (NULL);
+
+  for (i = 0; i < N_LATER_TYPES; i++)
+    {
+      if (later_runs[i] == 0)
+        continue;
+
+      g_string_append_printf (report, " %s %u/%" G_GINT64_FORMAT "us",
+                              later_type_name (i), later_runs[i], later_usec[i]);
+      total_usec += later_usec[i];
+
+      later_runs[i] = 0;
+      later_usec[i] = 0;
+    }
+
+  if (report->len > 0)
+    meta_topic (META_DEBUG_COMPOSITOR,
+                "Laters this frame: %" G_GINT64_FORMAT "us,%s\n",
+                total_usec, report->str);
+
+  g_string_free (report, TRUE);
+}
+
+/* Runs the function of a later that is still queued, and removes the
+ * later if it's done. The caller must hold a reference. Returns the
+ * result of the function.
+ */
+static gboolean
+call_later (MetaLater *later,
+            gboolean   timing)
+{
+  gboolean result;
+  gint64 start = 0;
+
+  if (timing)
+    start = g_get_monotonic_time ();
+
+  result = later->func (later->data);
+
+  if (timing)
+    {
+      later_usec[later->when] += g_get_monotonic_time () - start;
+      later_runs[later->when]++;
+    }
+
+  if (!result)
+    meta_later_remove (later->id);
+
+  return result;
 }
 
 static gboolean
 run_repaint_laters (gpointer data)
 {
-  GSList *laters_copy;
-  GSList *l;
+  MetaLaterQueue running[META_LATER_IDLE];
   gboolean keep_timeline_running = FALSE;
-
-  laters_copy = NULL;
-  for (l = laters; l; l = l->next)
+  gboolean timing;
+  MetaLater *later;
+  int i;
+
+  timing = later_timing_enabled ();
+
+  /* Only the laters already there are run in this frame, so move all
+   * of them aside before running any; anything they add, of whatever
+   * type, goes into the real queues and is run next time. Each one
+   * goes back into its real queue just before it runs, so it can be
+   * removed from there as usual. Idle laters never run from here.
+   */
+  for (i = 0; i < META_LATER_IDLE; i++)
     {
-      MetaLater *later = l->data;
-      if (later->source == 0 ||
-          (later->when <= META_LATER_BEFORE_REDRAW && !later->run_once))
-        {
-          later->ref_count++;
-          laters_copy = g_slist_prepend (laters_copy, later);
-        }
+      running[i] = later_queues[i];
+      later_queues[i].head = later_queues[i].tail = NULL;
+      for (later = running[i].head; later; later = later->next)
+        later->queue = &running[i];
     }
-  laters_copy = g_slist_reverse (laters_copy);
 
-  for (l = laters_copy; l; l = l->next)
+  for (i = 0; i < META_LATER_IDLE; i++)
     {
-      MetaLater *later = l->data;
+      MetaLaterQueue *queue = &later_queues[i];
 
-      if (later->func && later->func (later->data))
+      while ((later = running[i].head))
         {
-          if (later->source == 0)
+          later_queue_unlink (later);
+          later_queue_push (queue, later);
+
+          /* A resize later that has been run from its idle already
+           * waits for the next one
+           */
+          if (later->source != 0 && later->run_once)
+            continue;
+
+          later->ref_count++;
+
+          if (call_later (later, timing) && later->source == 0)
             keep_timeline_running = TRUE;
+
+          unref_later (later);
         }
-      else
-        meta_later_remove (later->id);
-      unref_later (later);
     }
 
+  if (timing)
+    report_later_timings ();
+
   if (!keep_timeline_running)
     clutter_timeline_stop (later_timeline);
 
-  g_slist_free (laters_copy);
-
   /* Just keep the repaint func around - it's cheap if the list is empty */
   return TRUE;
 }
@@ -855,17 +1679,15 @@ static gboolean
 call_idle_later (gpointer data)
 {
   MetaLater *later = data;
+  gboolean result;
 
-  if (!later->func (later->data))
-    {
-      meta_later_remove (later->id);
-      return FALSE;
-    }
-  else
-    {
-      later->run_once = TRUE;
-      return TRUE;
-    }
+  later->ref_count++;
+  result = call_later (later, later_timing_enabled ());
+  if (result)
+    later->run_once = TRUE;
+  unref_later (later);
+
+  return result;
 }
 
 /**
@@ -891,7 +1713,7 @@ meta_later_add (MetaLaterType  when,
                 gpointer       data,
                 GDestroyNotify notify)
 {
-  MetaLater *later = g_slice_new0 (MetaLater);
+  MetaLater *later = alloc_later ();
 
   later->id = ++last_later_id;
   later->ref_count = 1;
@@ -900,7 +1722,11 @@ meta_later_add (MetaLaterType  when,
   later->data = data;
   later->notify = notify;
 
-  laters = g_slist_insert_sorted (laters, later, compare_laters);
+  later_queue_push_head (&later_queues[when], later);
+
+  if (later_ids == NULL)
+    later_ids = g_hash_table_new (NULL, NULL);
+  g_hash_table_insert (later_ids, GUINT_TO_POINTER (later->id), later);
 
   switch (when)
     {
@@ -939,22 +1765,22 @@ meta_later_add (MetaLaterType  when,
 void
 meta_later_remove (guint later_id)
 {
-  GSList *l;
+  MetaLater *later;
 
-  for (l = laters; l; l = l->next)
-    {
-      MetaLater *later = l->data;
-      if (later->id == later_id)
-        {
-          laters = g_slist_delete_link (laters, l);
-          /* If this was a "repaint func" later, we just let the
-           * repaint func run and get removed
-           */
-          destroy_later (later);
-          return;
-        }
-    }
+  if (later_ids == NULL)
+    return;
+
+  later = g_hash_table_lookup (later_ids, GUINT_TO_POINTER (later_id));
+  if (later == NULL)
+    return;
+
+  g_hash_table_remove (later_ids, GUINT_TO_POINTER (later_id));
+  later_queue_unlink (later);
+
+  /* If this was a "repaint func" later, we just let the
+   * repaint func run and get removed
+   */
+  destroy_later (later);
 }
 
 /* eof util.c */
-
@@ -300,6 +300,9 @@ struct _MetaWindow
   
   /* Are we in the various queues? (Bitfield: see META_WINDOW_IS_IN_QUEUE) */
   guint is_in_queues : NUMBER_OF_QUEUES;
+
+  /* Are we in display->retheme_windows? */
+  guint retheme_queued : 1;
  
   /* Used by keybindings.c */
   guint keys_grabbed : 1;     /* normal keybindings grabbed */
@@ -537,6 +540,8 @@ void        meta_window_change_workspace   (MetaWindow  *window,
 /* Return whether the window should be currently mapped */
 gboolean    meta_window_should_be_showing   (MetaWindow  *window);
 
+void        meta_window_retheme             (MetaWindow  *window);
+
 /* See warning in window.c about this function */
 gboolean    __window_is_terminal (MetaWindow *window);
 
@@ -661,6 +666,8 @@ void meta_window_set_user_time (MetaWindow *window,
                                 guint32     timestamp);
 
 void meta_window_update_icon_now (MetaWindow *window);
+GdkPixbuf *meta_window_get_icon      (MetaWindow *window);
+GdkPixbuf *meta_window_get_mini_icon (MetaWindow *window);
 
 void meta_window_update_role (MetaWindow *window);
 void meta_window_update_net_wm_type (MetaWindow *window);
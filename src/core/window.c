@@ -202,18 +202,19 @@ enum
 static guint window_signals[LAST_SIGNAL] = { 0 };
 
 static void
-prefs_changed_callback (MetaPreference pref,
-                        gpointer       data)
+prefs_changed_callback (MetaPrefsChanges changes,
+                        gpointer         data)
 {
   MetaWindow *window = data;
 
-  if (pref == META_PREF_WORKSPACES_ONLY_ON_PRIMARY)
+  if (META_PREFS_CHANGED (changes, META_PREF_WORKSPACES_ONLY_ON_PRIMARY))
     {
       meta_window_update_on_all_workspaces (window);
       meta_window_queue (window, META_QUEUE_CALC_SHOWING);
     }
-  else if (pref == META_PREF_ATTACH_MODAL_DIALOGS &&
-           window->type == META_WINDOW_MODAL_DIALOG)
+
+  if (META_PREFS_CHANGED (changes, META_PREF_ATTACH_MODAL_DIALOGS) &&
+      window->type == META_WINDOW_MODAL_DIALOG)
     {
       window->attached = meta_window_should_attach_to_parent (window);
       recalc_window_features (window);
@@ -277,10 +278,10 @@ meta_window_get_property(GObject         *object,
       g_value_set_string (value, win->title);
       break;
     case PROP_ICON:
-      g_value_set_object (value, win->icon);
+      g_value_set_object (value, meta_window_get_icon (win));
       break;
     case PROP_MINI_ICON:
-      g_value_set_object (value, win->mini_icon);
+      g_value_set_object (value, meta_window_get_mini_icon (win));
       break;
     case PROP_DECORATED:
       g_value_set_boolean (value, win->decorated);
@@ -604,7 +605,7 @@ meta_window_class_init (MetaWindowClass *klass)
 static void
 meta_window_init (MetaWindow *self)
 {
-  meta_prefs_add_listener (prefs_changed_callback, self);
+  meta_prefs_add_changes_listener (prefs_changed_callback, self);
 }
 
 #ifdef WITH_VERBOSE_MODE
@@ -1184,9 +1185,6 @@ meta_window_new (MetaDisplay   *display,
 
   meta_window_update_net_wm_type (window);
 
-  if (!window->override_redirect)
-    meta_window_update_icon_now (window);
-
   if (window->initially_iconic)
     {
       /* WM_HINTS said minimized */
@@ -1752,6 +1750,8 @@ meta_window_unmanage (MetaWindow  *window,
   meta_window_unqueue (window, META_QUEUE_CALC_SHOWING |
                                META_QUEUE_MOVE_RESIZE |
                                META_QUEUE_UPDATE_ICON);
+  if (window->retheme_queued)
+    meta_display_unqueue_retheme (window->display, window);
   meta_window_free_delete_dialog (window);
 
   if (window->workspace)
@@ -1884,7 +1884,7 @@ meta_window_unmanage (MetaWindow  *window,
 
   meta_error_trap_pop (window->display);
 
-  meta_prefs_remove_listener (prefs_changed_callback, window);
+  meta_prefs_remove_changes_listener (prefs_changed_callback, window);
 
   meta_screen_queue_check_fullscreen (window->screen);
 
@@ -1915,6 +1915,16 @@ meta_window_update_on_all_workspaces (MetaWindow *window)
   if (window->on_all_workspaces != old_value &&
       !window->override_redirect)
     {
+      if (window->workspace != NULL)
+        {
+          if (window->on_all_workspaces)
+            window->screen->sticky_windows =
+              g_list_prepend (window->screen->sticky_windows, window);
+          else
+            window->screen->sticky_windows =
+              g_list_remove (window->screen->sticky_windows, window);
+        }
+
       if (window->on_all_workspaces)
         {
           GList* tmp = window->screen->workspaces;
@@ -2948,6 +2958,13 @@ meta_window_show (MetaWindow *window)
               "Showing window %s, shaded: %d iconic: %d placed: %d\n",
               window->desc, window->shaded, window->iconic, window->placed);
 
+  /* Don't map it with the borders of the old theme */
+  if (window->retheme_queued)
+    {
+      meta_display_unqueue_retheme (window->display, window);
+      meta_window_retheme (window);
+    }
+
   toplevel_was_mapped = meta_window_toplevel_is_mapped (window);
 
   focus_window = window->display->focus_window;  /* May be NULL! */
@@ -5545,6 +5562,26 @@ meta_window_move_resize_now (MetaWindow  *window)
                            window->user_rect.height);
 }
 
+/**
+ * meta_window_retheme: (skip)
+ * @window: a #MetaWindow
+ *
+ * Recomputes the frame borders of @window, and its size with them, and
+ * redraws the frame, right away rather than from the move/resize queue.
+ */
+void
+meta_window_retheme (MetaWindow *window)
+{
+  meta_window_unqueue (window, META_QUEUE_MOVE_RESIZE);
+
+  if (window->frame)
+    meta_frame_queue_draw (window->frame);
+
+  destroying_windows_disallowed += 1;
+  meta_window_move_resize_now (window);
+  destroying_windows_disallowed -= 1;
+}
+
 static gboolean
 idle_move_resize (gpointer data)
 {
@@ -7884,13 +7921,22 @@ redraw_icon (MetaWindow *window)
     meta_ui_queue_frame_draw (window->screen->ui, window->frame->xwindow);
 }
 
-void
-meta_window_update_icon_now (MetaWindow *window)
+/* Icons are only decoded when somebody asks for them; when the icon
+ * properties change we just note that the cache is stale and tell
+ * whoever is displaying the icons to come back for new ones.
+ */
+static void
+meta_window_ensure_icons (MetaWindow *window)
 {
   GdkPixbuf *icon;
   GdkPixbuf *mini_icon;
 
-  g_return_if_fail (!window->override_redirect);
+  if (window->override_redirect)
+    return;
+
+  if (window->icon != NULL &&
+      !meta_icon_cache_get_icon_invalidated (&window->icon_cache))
+    return;
 
   icon = NULL;
   mini_icon = NULL;
@@ -7914,19 +7960,50 @@ meta_window_update_icon_now (MetaWindow *window)
 
       window->icon = icon;
       window->mini_icon = mini_icon;
-
-      g_object_freeze_notify (G_OBJECT (window));
-      g_object_notify (G_OBJECT (window), "icon");
-      g_object_notify (G_OBJECT (window), "mini-icon");
-      g_object_thaw_notify (G_OBJECT (window));
-
-      redraw_icon (window);
     }
 
   g_assert (window->icon);
   g_assert (window->mini_icon);
 }
 
+GdkPixbuf *
+meta_window_get_icon (MetaWindow *window)
+{
+  meta_window_ensure_icons (window);
+
+  return window->icon;
+}
+
+GdkPixbuf *
+meta_window_get_mini_icon (MetaWindow *window)
+{
+  meta_window_ensure_icons (window);
+
+  return window->mini_icon;
+}
+
+void
+meta_window_update_icon_now (MetaWindow *window)
+{
+  g_return_if_fail (!window->override_redirect);
+
+  if (!meta_icon_cache_get_icon_invalidated (&window->icon_cache))
+    return;
+
+  /* Nobody has looked at the icons yet, so nobody needs to hear
+   * that they changed either.
+   */
+  if (window->icon == NULL)
+    return;
+
+  g_object_freeze_notify (G_OBJECT (window));
+  g_object_notify (G_OBJECT (window), "icon");
+  g_object_notify (G_OBJECT (window), "mini-icon");
+  g_object_thaw_notify (G_OBJECT (window));
+
+  redraw_icon (window);
+}
+
 static gboolean
 idle_update_icon (gpointer data)
 {
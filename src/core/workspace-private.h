@@ -67,6 +67,15 @@ struct _MetaWorkspace
   GSList *all_struts;
   guint work_areas_invalid : 1;
 
+  /* What the work areas were computed from before the last
+   * invalidation; monitors whose struts did not change reuse them.
+   */
+  GSList *prev_struts;
+  GList  **prev_monitor_region;
+  MetaRectangle *prev_work_area_monitor;
+  MetaRectangle *prev_monitor_rects;
+  gint n_prev_monitors;
+
   guint showing_desktop : 1;
 };
 
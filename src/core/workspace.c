@@ -198,6 +198,12 @@ meta_workspace_new (MetaScreen *screen)
   workspace->builtin_struts = NULL;
   workspace->all_struts = NULL;
 
+  workspace->prev_struts = NULL;
+  workspace->prev_monitor_region = NULL;
+  workspace->prev_work_area_monitor = NULL;
+  workspace->prev_monitor_rects = NULL;
+  workspace->n_prev_monitors = 0;
+
   workspace->showing_desktop = FALSE;
   
   return workspace;
@@ -244,6 +250,37 @@ workspace_free_builtin_struts (MetaWorkspace *workspace)
   workspace->builtin_struts = NULL;
 }
 
+/**
+ * workspace_free_prev_work_areas:
+ * @workspace: The workspace.
+ *
+ * Frees whatever is left of the work areas saved by the last
+ * meta_workspace_invalidate_work_area().
+ */
+static void
+workspace_free_prev_work_areas (MetaWorkspace *workspace)
+{
+  int i;
+
+  if (workspace->prev_monitor_region != NULL)
+    {
+      for (i = 0; i < workspace->n_prev_monitors; i++)
+        meta_rectangle_free_list_and_elements (workspace->prev_monitor_region[i]);
+      g_free (workspace->prev_monitor_region);
+      workspace->prev_monitor_region = NULL;
+    }
+
+  g_slist_foreach (workspace->prev_struts, free_this, NULL);
+  g_slist_free (workspace->prev_struts);
+  workspace->prev_struts = NULL;
+
+  g_free (workspace->prev_work_area_monitor);
+  workspace->prev_work_area_monitor = NULL;
+  g_free (workspace->prev_monitor_rects);
+  workspace->prev_monitor_rects = NULL;
+  workspace->n_prev_monitors = 0;
+}
+
 void
 meta_workspace_remove (MetaWorkspace *workspace)
 {
@@ -284,6 +321,7 @@ meta_workspace_remove (MetaWorkspace *workspace)
   g_list_free (workspace->list_containing_self);
 
   workspace_free_builtin_struts (workspace);
+  workspace_free_prev_work_areas (workspace);
 
   /* screen.c:update_num_workspaces(), which calls us, removes windows from
    * workspaces first, which can cause the workareas on the workspace to be
@@ -344,6 +382,10 @@ meta_workspace_add_window (MetaWorkspace *workspace,
 
   window->workspace = workspace;
 
+  if (window->on_all_workspaces)
+    window->screen->sticky_windows =
+      g_list_prepend (window->screen->sticky_windows, window);
+
   meta_window_set_current_workspace_hint (window);
   
   if (window->struts)
@@ -372,6 +414,10 @@ meta_workspace_remove_window (MetaWorkspace *workspace,
   workspace->windows = g_list_remove (workspace->windows, window);
   window->workspace = NULL;
 
+  if (window->on_all_workspaces)
+    window->screen->sticky_windows =
+      g_list_remove (window->screen->sticky_windows, window);
+
   /* If the window is on all workspaces, we don't want to remove it
    * from the MRU list unless this causes it to be removed from all 
    * workspaces
@@ -738,28 +784,22 @@ meta_workspace_update_window_hints (MetaWorkspace *workspace)
 GList*
 meta_workspace_list_windows (MetaWorkspace *workspace)
 {
-  GSList *display_windows;
-  GSList *tmp;
   GList *workspace_windows;
-  
-  display_windows = meta_display_list_windows (workspace->screen->display,
-                                               META_LIST_DEFAULT);
+  GList *tmp;
 
-  workspace_windows = NULL;
-  tmp = display_windows;
-  while (tmp != NULL)
+  /* Every managed window is in exactly one workspace's window list;
+   * sticky ones additionally show up here from the screen's list.
+   */
+  workspace_windows = g_list_copy (workspace->windows);
+
+  for (tmp = workspace->screen->sticky_windows; tmp != NULL; tmp = tmp->next)
     {
       MetaWindow *window = tmp->data;
 
-      if (meta_window_located_on_workspace (window, workspace))
-        workspace_windows = g_list_prepend (workspace_windows,
-                                            window);
-
-      tmp = tmp->next;
+      if (window->workspace != workspace)
+        workspace_windows = g_list_prepend (workspace_windows, window);
     }
 
-  g_slist_free (display_windows);
-
   return workspace_windows;
 }
 
@@ -787,14 +827,23 @@ meta_workspace_invalidate_work_area (MetaWorkspace *workspace)
   if (workspace == workspace->screen->active_workspace)
     meta_display_cleanup_edges (workspace->screen->display);
 
-  g_free (workspace->work_area_monitor);
+  /* Keep the per-monitor results around; ensure_work_areas_validated()
+   * reuses them for monitors none of the changed struts touch.
+   */
+  workspace_free_prev_work_areas (workspace);
+
+  workspace->prev_struts = workspace->all_struts;
+  workspace->prev_monitor_region = workspace->monitor_region;
+  workspace->prev_work_area_monitor = workspace->work_area_monitor;
+  workspace->n_prev_monitors = workspace->screen->n_monitor_infos;
+  workspace->prev_monitor_rects = g_new (MetaRectangle,
+                                         workspace->n_prev_monitors);
+  for (i = 0; i < workspace->n_prev_monitors; i++)
+    workspace->prev_monitor_rects[i] = workspace->screen->monitor_infos[i].rect;
+
+  workspace->all_struts = NULL;
   workspace->work_area_monitor = NULL;
-      
-  workspace_free_all_struts (workspace);
 
-  for (i = 0; i < workspace->screen->n_monitor_infos; i++)
-    meta_rectangle_free_list_and_elements (workspace->monitor_region[i]);
-  g_free (workspace->monitor_region);
   meta_rectangle_free_list_and_elements (workspace->screen_region);
   meta_rectangle_free_list_and_elements (workspace->screen_edges);
   meta_rectangle_free_list_and_elements (workspace->monitor_edges);
@@ -842,11 +891,138 @@ copy_strut_list(GSList *original)
   return g_slist_reverse (result);
 }
 
+static gboolean
+strut_lists_equal (GSList *l,
+                   GSList *m)
+{
+  for (; l && m; l = l->next, m = m->next)
+    {
+      MetaStrut *a = l->data;
+      MetaStrut *b = m->data;
+
+      if (a->side != b->side ||
+          !meta_rectangle_equal (&a->rect, &b->rect))
+        return FALSE;
+    }
+
+  return l == NULL && m == NULL;
+}
+
+/* Like strut_lists_equal(), but only looks at the struts that
+ * overlap @rect, since no other strut can change the region
+ * computed for it.
+ */
+static gboolean
+struts_overlapping_rect_equal (GSList              *l,
+                               GSList              *m,
+                               const MetaRectangle *rect)
+{
+  while (TRUE)
+    {
+      MetaStrut *a, *b;
+
+      while (l && !meta_rectangle_overlap (&((MetaStrut *) l->data)->rect, rect))
+        l = l->next;
+      while (m && !meta_rectangle_overlap (&((MetaStrut *) m->data)->rect, rect))
+        m = m->next;
+
+      if (l == NULL || m == NULL)
+        return l == NULL && m == NULL;
+
+      a = l->data;
+      b = m->data;
+
+      if (a->side != b->side ||
+          !meta_rectangle_equal (&a->rect, &b->rect))
+        return FALSE;
+
+      l = l->next;
+      m = m->next;
+    }
+}
+
+/* Deep copy of a list of MetaRectangles or MetaEdges, so it can be
+ * freed with meta_rectangle_free_list_and_elements().
+ */
+static GList *
+copy_region_list (GList *list,
+                  gsize  element_size)
+{
+  GList *result = NULL;
+
+  for (; list != NULL; list = list->next)
+    result = g_list_prepend (result, g_memdup (list->data, element_size));
+
+  return g_list_reverse (result);
+}
+
+/* Copies the validated work areas of @source, which was computed from
+ * the same struts, instead of computing them all over again.
+ */
+static void
+copy_work_areas (MetaWorkspace *workspace,
+                 MetaWorkspace *source)
+{
+  int n_monitors = workspace->screen->n_monitor_infos;
+  int i;
+
+  meta_topic (META_DEBUG_WORKAREA,
+              "Workspace %d has the same struts as workspace %d, "
+              "copying its work areas\n",
+              meta_workspace_index (workspace),
+              meta_workspace_index (source));
+
+  workspace->monitor_region = g_new (GList*, n_monitors);
+  for (i = 0; i < n_monitors; i++)
+    workspace->monitor_region[i] =
+      copy_region_list (source->monitor_region[i], sizeof (MetaRectangle));
+  workspace->screen_region =
+    copy_region_list (source->screen_region, sizeof (MetaRectangle));
+
+  workspace->work_area_screen = source->work_area_screen;
+  g_free (workspace->work_area_monitor);
+  workspace->work_area_monitor = g_memdup (source->work_area_monitor,
+                                           n_monitors * sizeof (MetaRectangle));
+
+  workspace->screen_edges =
+    copy_region_list (source->screen_edges, sizeof (MetaEdge));
+  workspace->monitor_edges =
+    copy_region_list (source->monitor_edges, sizeof (MetaEdge));
+}
+
+/* Returns the region for monitor @i left over from before the last
+ * invalidation, if neither the monitor nor the struts overlapping it
+ * have changed since; ownership passes to the caller.
+ */
+static gboolean
+steal_prev_monitor_region (MetaWorkspace *workspace,
+                           int            i,
+                           GList        **region,
+                           MetaRectangle *work_area)
+{
+  MetaRectangle *rect = &workspace->screen->monitor_infos[i].rect;
+
+  if (workspace->prev_monitor_region == NULL ||
+      i >= workspace->n_prev_monitors ||
+      !meta_rectangle_equal (rect, &workspace->prev_monitor_rects[i]) ||
+      !struts_overlapping_rect_equal (workspace->all_struts,
+                                      workspace->prev_struts,
+                                      rect))
+    return FALSE;
+
+  *region = workspace->prev_monitor_region[i];
+  *work_area = workspace->prev_work_area_monitor[i];
+  workspace->prev_monitor_region[i] = NULL;
+
+  return TRUE;
+}
+
 static void
 ensure_work_areas_validated (MetaWorkspace *workspace)
 {
   GList         *windows;
   GList         *tmp;
+  gboolean      *reused;
   MetaRectangle  work_area;
   int            i;  /* C89 absolutely sucks... */
 
@@ -876,6 +1052,24 @@ ensure_work_areas_validated (MetaWorkspace *workspace)
     }
   g_list_free (windows);
 
+  /* Panels are normally sticky, so usually every workspace has the
+   * same struts; if one of them has already done the work, use that.
+   */
+  for (tmp = workspace->screen->workspaces; tmp != NULL; tmp = tmp->next)
+    {
+      MetaWorkspace *other = tmp->data;
+
+      if (other != workspace &&
+          !other->work_areas_invalid &&
+          strut_lists_equal (workspace->all_struts, other->all_struts))
+        {
+          copy_work_areas (workspace, other);
+          workspace_free_prev_work_areas (workspace);
+          workspace->work_areas_invalid = FALSE;
+          return;
+        }
+    }
+
   /* STEP 2: Get the maximal/spanning rects for the onscreen and
    *         on-single-monitor regions
    */  
@@ -884,8 +1078,21 @@ ensure_work_areas_validated (MetaWorkspace *workspace)
 
   workspace->monitor_region = g_new (GList*,
                                       workspace->screen->n_monitor_infos);
+  workspace->work_area_monitor = g_new (MetaRectangle,
+                                         workspace->screen->n_monitor_infos);
+  reused = g_newa (gboolean, workspace->screen->n_monitor_infos);
   for (i = 0; i < workspace->screen->n_monitor_infos; i++)
     {
+      if (steal_prev_monitor_region (workspace, i,
+                                     &workspace->monitor_region[i],
+                                     &workspace->work_area_monitor[i]))
+        {
+          reused[i] = TRUE;
+          continue;
+        }
+
+      reused[i] = FALSE;
+
       workspace->monitor_region[i] =
         meta_rectangle_get_minimal_spanning_set_for_region (
           &workspace->screen->monitor_infos[i].rect,
@@ -953,12 +1160,11 @@ ensure_work_areas_validated (MetaWorkspace *workspace)
               workspace->work_area_screen.height);    
 
   /* Now find the work areas for each monitor */
-  g_free (workspace->work_area_monitor);
-  workspace->work_area_monitor = g_new (MetaRectangle,
-                                         workspace->screen->n_monitor_infos);
-
   for (i = 0; i < workspace->screen->n_monitor_infos; i++)
     {
+      if (reused[i])
+        continue;
+
       work_area = workspace->screen->monitor_infos[i].rect;
 
       if (workspace->monitor_region[i] == NULL)
@@ -1008,27 +1214,12 @@ ensure_work_areas_validated (MetaWorkspace *workspace)
                                                        workspace->all_struts);
   g_list_free (tmp);
 
+  workspace_free_prev_work_areas (workspace);
+
   /* We're all done, YAAY!  Record that everything has been validated. */
   workspace->work_areas_invalid = FALSE;
 }
 
-static gboolean
-strut_lists_equal (GSList *l,
-                   GSList *m)
-{
-  for (; l && m; l = l->next, m = m->next)
-    {
-      MetaStrut *a = l->data;
-      MetaStrut *b = m->data;
-
-      if (a->side != b->side ||
-          !meta_rectangle_equal (&a->rect, &b->rect))
-        return FALSE;
-    }
-
-  return l == NULL && m == NULL;
-}
-
 /**
  * meta_workspace_set_builtin_struts:
  * @workspace: a #MetaWorkspace
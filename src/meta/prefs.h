@@ -110,11 +110,30 @@ typedef enum
 typedef void (* MetaPrefsChangedFunc) (MetaPreference pref,
                                        gpointer       user_data);
 
+/**
+ * MetaPrefsChanges:
+ *
+ * A set of #MetaPreference values, one bit each; test it with
+ * META_PREFS_CHANGED().
+ */
+typedef guint64 MetaPrefsChanges;
+
+#define META_PREFS_CHANGED(changes, pref) \
+  (((changes) & ((MetaPrefsChanges) 1 << (pref))) != 0)
+
+typedef void (* MetaPrefsChangesFunc) (MetaPrefsChanges changes,
+                                       gpointer         user_data);
+
 void meta_prefs_add_listener    (MetaPrefsChangedFunc func,
                                  gpointer             user_data);
 void meta_prefs_remove_listener (MetaPrefsChangedFunc func,
                                  gpointer             user_data);
 
+void meta_prefs_add_changes_listener    (MetaPrefsChangesFunc func,
+                                         gpointer             user_data);
+void meta_prefs_remove_changes_listener (MetaPrefsChangesFunc func,
+                                         gpointer             user_data);
+
 void meta_prefs_init (void);
 
 void meta_prefs_override_preference_schema (const char *key,
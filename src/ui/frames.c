@@ -81,6 +81,20 @@ static void meta_frames_calc_geometry (MetaFrames        *frames,
                                        MetaUIFrame         *frame,
                                        MetaFrameGeometry *fgeom);
 
+static void meta_frames_update_hit_rects (MetaUIFrame       *frame,
+                                          MetaFrameGeometry *fgeom);
+
+/* A title layout in frames->layouts, and how many frames use it */
+typedef struct
+{
+  PangoLayout *layout;
+  guint n_users;
+} MetaSharedLayout;
+
+static void meta_shared_layout_free   (MetaSharedLayout *shared);
+
+static void meta_frames_release_layout (MetaFrames      *frames,
+                                        MetaUIFrame     *frame);
 static void meta_frames_ensure_layout (MetaFrames      *frames,
                                        MetaUIFrame     *frame);
 
@@ -99,6 +113,8 @@ static MetaFrameControl get_control  (MetaFrames        *frames,
                                       int                y);
 static void invalidate_whole_window (MetaFrames *frames,
                                      MetaUIFrame *frame);
+static void invalidate_titlebar (MetaFrames *frames,
+                                 MetaUIFrame *frame);
 
 G_DEFINE_TYPE (MetaFrames, meta_frames, GTK_TYPE_WINDOW);
 
@@ -169,20 +185,14 @@ unsigned_long_hash (gconstpointer v)
 }
 
 static void
-prefs_changed_callback (MetaPreference pref,
-                        void          *data)
+prefs_changed_callback (MetaPrefsChanges changes,
+                        void            *data)
 {
-  switch (pref)
-    {
-    case META_PREF_TITLEBAR_FONT:
-      meta_frames_font_changed (META_FRAMES (data));
-      break;
-    case META_PREF_BUTTON_LAYOUT:
-      meta_frames_button_layout_changed (META_FRAMES (data));
-      break;
-    default:
-      break;
-    }
+  if (META_PREFS_CHANGED (changes, META_PREF_TITLEBAR_FONT))
+    meta_frames_font_changed (META_FRAMES (data));
+
+  if (META_PREFS_CHANGED (changes, META_PREF_BUTTON_LAYOUT))
+    meta_frames_button_layout_changed (META_FRAMES (data));
 }
 
 static GtkStyleContext *
@@ -228,6 +238,10 @@ static void
 meta_frames_init (MetaFrames *frames)
 {
   frames->text_heights = g_hash_table_new (NULL, NULL);
+
+  frames->layouts = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                           g_free,
+                                           (GDestroyNotify) meta_shared_layout_free);
   
   frames->frames = g_hash_table_new (unsigned_long_hash, unsigned_long_equal);
 
@@ -237,7 +251,7 @@ meta_frames_init (MetaFrames *frames)
 
   gtk_widget_set_double_buffered (GTK_WIDGET (frames), FALSE);
 
-  meta_prefs_add_listener (prefs_changed_callback, frames);
+  meta_prefs_add_changes_listener (prefs_changed_callback, frames);
 }
 
 static void
@@ -294,9 +308,10 @@ meta_frames_finalize (GObject *object)
   
   frames = META_FRAMES (object);
 
-  meta_prefs_remove_listener (prefs_changed_callback, frames);
+  meta_prefs_remove_changes_listener (prefs_changed_callback, frames);
   
   g_hash_table_destroy (frames->text_heights);
+  g_hash_table_destroy (frames->layouts);
   
   g_assert (g_hash_table_size (frames->frames) == 0);
   g_hash_table_destroy (frames->frames);
@@ -322,16 +337,8 @@ queue_recalc_func (gpointer key, gpointer value, gpointer data)
   invalidate_whole_window (frames, frame);
   meta_core_queue_frame_resize (GDK_DISPLAY_XDISPLAY (gdk_display_get_default ()),
                                 frame->xwindow);
-  if (frame->layout)
-    {
-      /* save title to recreate layout */
-      g_free (frame->title);
-      
-      frame->title = g_strdup (pango_layout_get_text (frame->layout));
-
-      g_object_unref (G_OBJECT (frame->layout));
-      frame->layout = NULL;
-    }
+  meta_frames_release_layout (frames, frame);
+  frame->fgeom_valid = FALSE;
 }
 
 static void
@@ -347,6 +354,10 @@ meta_frames_font_changed (MetaFrames *frames)
   g_hash_table_foreach (frames->frames,
                         queue_recalc_func, frames);
 
+  /* The frames released their layouts above, which should have
+   * emptied this already
+   */
+  g_hash_table_remove_all (frames->layouts);
 }
 
 static void
@@ -367,9 +378,20 @@ queue_draw_func (gpointer key, gpointer value, gpointer data)
   invalidate_whole_window (frames, frame);
 }
 
+static void
+invalidate_geometry_func (gpointer key, gpointer value, gpointer data)
+{
+  MetaUIFrame *frame = value;
+
+  frame->fgeom_valid = FALSE;
+}
+
 static void
 meta_frames_button_layout_changed (MetaFrames *frames)
 {
+  g_hash_table_foreach (frames->frames,
+                        invalidate_geometry_func, frames);
+
   g_hash_table_foreach (frames->frames,
                         queue_draw_func, frames);
 }
@@ -397,12 +419,49 @@ meta_frames_style_updated  (GtkWidget *widget)
 
   update_style_contexts (frames);
 
+  if (meta_theme_get_current ())
+    meta_theme_clear_piece_cache (meta_theme_get_current ());
+
   g_hash_table_foreach (frames->frames,
                         reattach_style_func, frames);
 
   GTK_WIDGET_CLASS (meta_frames_parent_class)->style_updated (widget);
 }
 
+static void
+meta_shared_layout_free (MetaSharedLayout *shared)
+{
+  g_object_unref (G_OBJECT (shared->layout));
+  g_slice_free (MetaSharedLayout, shared);
+}
+
+static void
+meta_frames_release_layout (MetaFrames  *frames,
+                            MetaUIFrame *frame)
+{
+  MetaSharedLayout *shared;
+
+  if (frame->layout == NULL)
+    return;
+
+  /* Once no frame has this title, it's dropped from the table */
+  shared = g_hash_table_lookup (frames->layouts, frame->layout_key);
+  if (shared && shared->layout == frame->layout &&
+      --shared->n_users == 0)
+    g_hash_table_remove (frames->layouts, frame->layout_key);
+
+  g_object_unref (G_OBJECT (frame->layout));
+  frame->layout = NULL;
+
+  g_free (frame->layout_key);
+  frame->layout_key = NULL;
+}
+
+/* Title layouts are shared between frames, keyed by font and text, so
+ * that windows with the same title only get it shaped once, and so
+ * that flipping between frame styles with the same title scale, as
+ * happens on every focus change, keeps the layout.
+ */
 static void
 meta_frames_ensure_layout (MetaFrames  *frames,
                            MetaUIFrame *frame)
@@ -415,7 +474,7 @@ meta_frames_ensure_layout (MetaFrames  *frames,
   widget = GTK_WIDGET (frames);
 
   g_return_if_fail (gtk_widget_get_realized (widget));
-      
+
   meta_core_get (GDK_DISPLAY_XDISPLAY (gdk_display_get_default ()), frame->xwindow,
                  META_CORE_GET_FRAME_FLAGS, &flags,
                  META_CORE_GET_FRAME_TYPE, &type,
@@ -424,42 +483,71 @@ meta_frames_ensure_layout (MetaFrames  *frames,
   style = meta_theme_get_frame_style (meta_theme_get_current (),
                                       type, flags);
 
-  if (style != frame->cache_style)
-    {
-      if (frame->layout)
-        {
-          /* save title to recreate layout */
-          g_free (frame->title);
-          
-          frame->title = g_strdup (pango_layout_get_text (frame->layout));
-
-          g_object_unref (G_OBJECT (frame->layout));
-          frame->layout = NULL;
-        }
-    }
-
-  frame->cache_style = style;
-  
-  if (frame->layout == NULL)
+  if (frame->layout == NULL || style != frame->cache_style)
     {
       gpointer key, value;
       PangoFontDescription *font_desc;
+      char *font_name;
+      char *layout_key;
       double scale;
       int size;
-      
+
       scale = meta_theme_get_title_scale (meta_theme_get_current (),
                                           type,
                                           flags);
-      
-      frame->layout = gtk_widget_create_pango_layout (widget, frame->title);
-
-      pango_layout_set_ellipsize (frame->layout, PANGO_ELLIPSIZE_END);
-      pango_layout_set_auto_dir (frame->layout, FALSE);
-      pango_layout_set_single_paragraph_mode (frame->layout, TRUE);
 
       font_desc = meta_gtk_widget_get_font_desc (widget, scale,
                                                  meta_prefs_get_titlebar_font ());
 
+      font_name = pango_font_description_to_string (font_desc);
+      layout_key = g_strdup_printf ("%s\x1f%s", font_name,
+                                    frame->title ? frame->title : "");
+      g_free (font_name);
+
+      if (frame->layout_key && strcmp (layout_key, frame->layout_key) == 0)
+        {
+          g_free (layout_key);
+        }
+      else
+        {
+          MetaSharedLayout *shared;
+
+          meta_frames_release_layout (frames, frame);
+
+          shared = g_hash_table_lookup (frames->layouts, layout_key);
+          if (shared)
+            {
+              frame->layout = g_object_ref (G_OBJECT (shared->layout));
+              shared->n_users++;
+              frames->layout_hits++;
+            }
+          else
+            {
+              frame->layout = gtk_widget_create_pango_layout (widget, frame->title);
+
+              pango_layout_set_ellipsize (frame->layout, PANGO_ELLIPSIZE_END);
+              pango_layout_set_auto_dir (frame->layout, FALSE);
+              pango_layout_set_single_paragraph_mode (frame->layout, TRUE);
+              pango_layout_set_font_description (frame->layout,
+                                                 font_desc);
+
+              shared = g_slice_new (MetaSharedLayout);
+              shared->layout = g_object_ref (G_OBJECT (frame->layout));
+              shared->n_users = 1;
+
+              g_hash_table_insert (frames->layouts, g_strdup (layout_key),
+                                   shared);
+              frames->layout_misses++;
+            }
+
+          frame->layout_key = layout_key;
+
+          meta_topic (META_DEBUG_THEMES,
+                      "Title layouts: %u hits, %u misses, %u cached\n",
+                      frames->layout_hits, frames->layout_misses,
+                      g_hash_table_size (frames->layouts));
+        }
+
       size = pango_font_description_get_size (font_desc);
 
       if (g_hash_table_lookup_extended (frames->text_heights,
@@ -478,16 +566,11 @@ meta_frames_ensure_layout (MetaFrames  *frames,
                                 GINT_TO_POINTER (size),
                                 GINT_TO_POINTER (frame->text_height));
         }
-      
-      pango_layout_set_font_description (frame->layout, 
-                                         font_desc);
-      
-      pango_font_description_free (font_desc);
 
-      /* Save some RAM */
-      g_free (frame->title);
-      frame->title = NULL;
+      pango_font_description_free (font_desc);
     }
+
+  frame->cache_style = style;
 }
 
 static void
@@ -509,6 +592,24 @@ meta_frames_calc_geometry (MetaFrames        *frames,
 
   meta_frames_ensure_layout (frames, frame);
 
+  /* This gets called for every motion event over a frame and for every
+   * paint, while the inputs rarely change, so reuse the last result.
+   * The button layout isn't part of the key; changing it invalidates
+   * all frames instead.
+   */
+  if (frame->fgeom_valid &&
+      frame->cache_style != NULL &&
+      frame->fgeom_layout == frame->cache_style->layout &&
+      frame->fgeom_type == type &&
+      frame->fgeom_flags == flags &&
+      frame->fgeom_width == width &&
+      frame->fgeom_height == height &&
+      frame->fgeom_text_height == frame->text_height)
+    {
+      *fgeom = frame->fgeom;
+      return;
+    }
+
   meta_prefs_get_button_layout (&button_layout);
   
   meta_theme_calc_geometry (meta_theme_get_current (),
@@ -518,6 +619,19 @@ meta_frames_calc_geometry (MetaFrames        *frames,
                             width, height,
                             &button_layout,
                             fgeom);
+
+  frame->fgeom = *fgeom;
+  frame->fgeom_layout = frame->cache_style ? frame->cache_style->layout : NULL;
+  frame->fgeom_type = type;
+  frame->fgeom_flags = flags;
+  frame->fgeom_width = width;
+  frame->fgeom_height = height;
+  frame->fgeom_text_height = frame->text_height;
+
+  meta_frames_update_hit_rects (frame, fgeom);
+
+  /* Without a style nothing got calculated, so don't reuse it */
+  frame->fgeom_valid = frame->cache_style != NULL;
 }
 
 MetaFrames*
@@ -584,9 +698,11 @@ meta_frames_manage_window (MetaFrames *frames,
   frame->xwindow = xwindow;
   frame->cache_style = NULL;
   frame->layout = NULL;
+  frame->layout_key = NULL;
   frame->text_height = -1;
   frame->title = NULL;
   frame->shape_applied = FALSE;
+  frame->fgeom_valid = FALSE;
   frame->prelit_control = META_FRAME_CONTROL_NONE;
 
   /* Don't set the window background yet; we need frame->xwindow to be
@@ -625,8 +741,7 @@ meta_frames_unmanage_window (MetaFrames *frames,
 
       gdk_window_destroy (frame->window);
 
-      if (frame->layout)
-        g_object_unref (G_OBJECT (frame->layout));
+      meta_frames_release_layout (frames, frame);
 
       if (frame->title)
         g_free (frame->title);
@@ -964,13 +1079,9 @@ meta_frames_set_title (MetaFrames *frames,
   g_free (frame->title);
   frame->title = g_strdup (title);
   
-  if (frame->layout)
-    {
-      g_object_unref (frame->layout);
-      frame->layout = NULL;
-    }
+  meta_frames_release_layout (frames, frame);
 
-  invalidate_whole_window (frames, frame);
+  invalidate_titlebar (frames, frame);
 }
 
 void
@@ -1931,6 +2042,28 @@ meta_frames_get_mask (MetaFrames          *frames,
   cairo_restore (cr);
 }
 
+/**
+ * meta_frames_paint_frame: (skip)
+ * @frames: The #MetaFrames
+ * @xwindow: The X window for the frame
+ * @cr: Where to draw the frame, in frame window coordinates
+ *
+ * Draws the frame the same way it would be drawn into its X window,
+ * for a compositor drawing decorations itself.
+ */
+void
+meta_frames_paint_frame (MetaFrames *frames,
+                         Window      xwindow,
+                         cairo_t    *cr)
+{
+  MetaUIFrame *frame = meta_frames_lookup_window (frames, xwindow);
+
+  if (frame == NULL)
+    meta_bug ("No such frame 0x%lx\n", xwindow);
+
+  meta_frames_paint (frames, frame, cr);
+}
+
 static gboolean
 meta_frames_draw (GtkWidget *widget,
                   cairo_t   *cr)
@@ -1950,6 +2083,11 @@ meta_frames_draw (GtkWidget *widget,
   if (frame == NULL)
     return FALSE;
 
+  /* If the compositor draws this frame, leave the X window alone */
+  if (meta_core_queue_decorations_redraw (GDK_DISPLAY_XDISPLAY (gdk_display_get_default ()),
+                                          frame->xwindow))
+    return TRUE;
+
   region = cairo_region_create_rectangle (&clip);
   clip_region_to_visible_frame_border (region, frame);
 
@@ -2252,6 +2390,56 @@ control_rect (MetaFrameControl control,
 
 #define TOP_RESIZE_HEIGHT 4
 #define CORNER_SIZE_MULT 2
+
+static void
+add_hit_rect (MetaUIFrame           *frame,
+              cairo_rectangle_int_t *rect,
+              MetaFrameControl       control)
+{
+  MetaFrameHitRect *hit;
+
+  /* Buttons that aren't in the layout have empty rects, and nothing
+   * can hit those
+   */
+  if (rect->width <= 0 || rect->height <= 0)
+    return;
+
+  g_assert (frame->n_hit_rects < META_FRAME_MAX_HIT_RECTS);
+
+  hit = &frame->hit_rects[frame->n_hit_rects++];
+  hit->rect = *rect;
+  hit->control = control;
+}
+
+/* Precomputes the rectangles get_control() looks at, so that motion
+ * over a frame only has to walk the ones that exist.
+ */
+static void
+meta_frames_update_hit_rects (MetaUIFrame       *frame,
+                              MetaFrameGeometry *fgeom)
+{
+  cairo_rectangle_int_t client;
+
+  frame->n_hit_rects = 0;
+
+  get_client_rect (fgeom, fgeom->width, fgeom->height, &client);
+
+  add_hit_rect (frame, &client, META_FRAME_CONTROL_CLIENT_AREA);
+  add_hit_rect (frame, &fgeom->close_rect.clickable, META_FRAME_CONTROL_DELETE);
+  add_hit_rect (frame, &fgeom->min_rect.clickable, META_FRAME_CONTROL_MINIMIZE);
+  add_hit_rect (frame, &fgeom->menu_rect.clickable, META_FRAME_CONTROL_MENU);
+  add_hit_rect (frame, &fgeom->title_rect, META_FRAME_CONTROL_TITLE);
+  add_hit_rect (frame, &fgeom->max_rect.clickable,
+                (frame->fgeom_flags & META_FRAME_MAXIMIZED) ?
+                META_FRAME_CONTROL_UNMAXIMIZE : META_FRAME_CONTROL_MAXIMIZE);
+  add_hit_rect (frame, &fgeom->shade_rect.clickable, META_FRAME_CONTROL_SHADE);
+  add_hit_rect (frame, &fgeom->unshade_rect.clickable, META_FRAME_CONTROL_UNSHADE);
+  add_hit_rect (frame, &fgeom->above_rect.clickable, META_FRAME_CONTROL_ABOVE);
+  add_hit_rect (frame, &fgeom->unabove_rect.clickable, META_FRAME_CONTROL_UNABOVE);
+  add_hit_rect (frame, &fgeom->stick_rect.clickable, META_FRAME_CONTROL_STICK);
+  add_hit_rect (frame, &fgeom->unstick_rect.clickable, META_FRAME_CONTROL_UNSTICK);
+}
+
 static MetaFrameControl
 get_control (MetaFrames *frames,
              MetaUIFrame *frame,
@@ -2262,77 +2450,30 @@ get_control (MetaFrames *frames,
   MetaFrameType type;
   gboolean has_vert, has_horiz;
   gboolean has_north_resize;
-  cairo_rectangle_int_t client;
+  int i;
 
   meta_frames_calc_geometry (frames, frame, &fgeom);
-  get_client_rect (&fgeom, fgeom.width, fgeom.height, &client);
-
-  if (POINT_IN_RECT (x, y, client))
-    return META_FRAME_CONTROL_CLIENT_AREA;
-  
-  if (POINT_IN_RECT (x, y, fgeom.close_rect.clickable))
-    return META_FRAME_CONTROL_DELETE;
-
-  if (POINT_IN_RECT (x, y, fgeom.min_rect.clickable))
-    return META_FRAME_CONTROL_MINIMIZE;
 
-  if (POINT_IN_RECT (x, y, fgeom.menu_rect.clickable))
-    return META_FRAME_CONTROL_MENU;
-
-  meta_core_get (GDK_DISPLAY_XDISPLAY (gdk_display_get_default ()),
-                 frame->xwindow,
-                 META_CORE_GET_FRAME_FLAGS, &flags,
-                 META_CORE_GET_FRAME_TYPE, &type,
-                 META_CORE_GET_END);
+  /* Recorded by meta_frames_calc_geometry() */
+  flags = frame->fgeom_flags;
+  type = frame->fgeom_type;
 
   has_north_resize = (type != META_FRAME_TYPE_ATTACHED);
   has_vert = (flags & META_FRAME_ALLOWS_VERTICAL_RESIZE) != 0;
   has_horiz = (flags & META_FRAME_ALLOWS_HORIZONTAL_RESIZE) != 0;
 
-  if (POINT_IN_RECT (x, y, fgeom.title_rect))
+  for (i = 0; i < frame->n_hit_rects; i++)
     {
-      if (has_vert && y <= TOP_RESIZE_HEIGHT && has_north_resize)
-        return META_FRAME_CONTROL_RESIZE_N;
-      else
-        return META_FRAME_CONTROL_TITLE;
-    }
+      const MetaFrameHitRect *hit = &frame->hit_rects[i];
 
-  if (POINT_IN_RECT (x, y, fgeom.max_rect.clickable))
-    {
-      if (flags & META_FRAME_MAXIMIZED)
-        return META_FRAME_CONTROL_UNMAXIMIZE;
-      else
-        return META_FRAME_CONTROL_MAXIMIZE;
-    }
-      
-  if (POINT_IN_RECT (x, y, fgeom.shade_rect.clickable))
-    {
-      return META_FRAME_CONTROL_SHADE;
-    }
-
-  if (POINT_IN_RECT (x, y, fgeom.unshade_rect.clickable))
-    {
-      return META_FRAME_CONTROL_UNSHADE;
-    }
-
-  if (POINT_IN_RECT (x, y, fgeom.above_rect.clickable))
-    {
-      return META_FRAME_CONTROL_ABOVE;
-    }
+      if (!POINT_IN_RECT (x, y, hit->rect))
+        continue;
 
-  if (POINT_IN_RECT (x, y, fgeom.unabove_rect.clickable))
-    {
-      return META_FRAME_CONTROL_UNABOVE;
-    }
-
-  if (POINT_IN_RECT (x, y, fgeom.stick_rect.clickable))
-    {
-      return META_FRAME_CONTROL_STICK;
-    }
+      if (hit->control == META_FRAME_CONTROL_TITLE &&
+          has_vert && y <= TOP_RESIZE_HEIGHT && has_north_resize)
+        return META_FRAME_CONTROL_RESIZE_N;
 
-  if (POINT_IN_RECT (x, y, fgeom.unstick_rect.clickable))
-    {
-      return META_FRAME_CONTROL_UNSTICK;
+      return hit->control;
     }
 
   /* South resize always has priority over north resize,
@@ -2412,3 +2553,29 @@ invalidate_whole_window (MetaFrames *frames,
 {
   gdk_window_invalidate_rect (frame->window, NULL, FALSE);
 }
+
+/* The title doesn't affect the frame geometry, so when it changes
+ * only the titlebar needs to be drawn again.
+ */
+static void
+invalidate_titlebar (MetaFrames *frames,
+                     MetaUIFrame *frame)
+{
+  MetaFrameGeometry fgeom;
+  GdkRectangle rect;
+
+  if (!gtk_widget_get_realized (GTK_WIDGET (frames)))
+    {
+      invalidate_whole_window (frames, frame);
+      return;
+    }
+
+  meta_frames_calc_geometry (frames, frame, &fgeom);
+
+  rect.x = fgeom.borders.invisible.left;
+  rect.y = fgeom.borders.invisible.top;
+  rect.width = fgeom.width - fgeom.borders.invisible.left - fgeom.borders.invisible.right;
+  rect.height = fgeom.borders.visible.top;
+
+  gdk_window_invalidate_rect (frame->window, &rect, FALSE);
+}
@@ -66,6 +66,18 @@ typedef enum
 #define META_IS_FRAMES_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), META_TYPE_FRAMES))
 #define META_FRAMES_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), META_TYPE_FRAMES, MetaFramesClass))
 
+/* A control under a rectangle of the frame, for get_control(); the
+ * client area, the title and the button rects, in the order they are
+ * tested.
+ */
+#define META_FRAME_MAX_HIT_RECTS (2 + MAX_BUTTONS_PER_CORNER)
+
+typedef struct
+{
+  cairo_rectangle_int_t rect;
+  MetaFrameControl control;
+} MetaFrameHitRect;
+
 typedef struct _MetaFrames        MetaFrames;
 typedef struct _MetaFramesClass   MetaFramesClass;
 
@@ -77,10 +89,25 @@ struct _MetaUIFrame
   GdkWindow *window;
   GtkStyleContext *style;
   MetaFrameStyle *cache_style;
-  PangoLayout *layout;
+  PangoLayout *layout; /* shared with frames that have the same title */
+  char *layout_key;
   int text_height;
-  char *title; /* NULL once we have a layout */
+  char *title;
   guint shape_applied : 1;
+  guint fgeom_valid : 1;
+
+  /* Last result of meta_frames_calc_geometry(), and what it was for */
+  MetaFrameGeometry fgeom;
+  MetaFrameLayout *fgeom_layout;
+  MetaFrameType fgeom_type;
+  MetaFrameFlags fgeom_flags;
+  int fgeom_width;
+  int fgeom_height;
+  int fgeom_text_height;
+
+  /* Built along with fgeom */
+  MetaFrameHitRect hit_rects[META_FRAME_MAX_HIT_RECTS];
+  int n_hit_rects;
   
   /* FIXME get rid of this, it can just be in the MetaFrames struct */
   MetaFrameControl prelit_control;
@@ -92,6 +119,11 @@ struct _MetaFrames
   
   GHashTable *text_heights;
 
+  /* Title layouts by font and text, see meta_frames_ensure_layout() */
+  GHashTable *layouts;
+  guint layout_hits;
+  guint layout_misses;
+
   GHashTable *frames;
   MetaUIFrame *last_motion_frame;
 
@@ -146,6 +178,10 @@ void meta_frames_get_mask (MetaFrames *frames,
                            guint       height,
                            cairo_t    *cr);
 
+void meta_frames_paint_frame (MetaFrames *frames,
+                              Window      xwindow,
+                              cairo_t    *cr);
+
 void meta_frames_move_resize_frame (MetaFrames *frames,
 				    Window      xwindow,
 				    int         x,
@@ -700,14 +700,42 @@ meta_gradient_create_multi_diagonal (int width, int height,
   return pixbuf;
 }
 
+/* Exact (x * alpha) / 255 for x and alpha in [0, 255], without
+ * the division.
+ */
+static inline guchar
+multiply_alpha (int x,
+                int alpha)
+{
+  int t = x * alpha;
+
+  return (t + 1 + (t >> 8)) >> 8;
+}
+
+/* The alpha multiply loops index the pixels rather than walking a
+ * pointer, and keep the gradient in its own array, so that the
+ * compiler can vectorize them.
+ */
+static void
+multiply_alpha_row (guchar       *row,
+                    const guchar *alphas,
+                    int           width)
+{
+  int x;
+
+  for (x = 0; x < width; x++)
+    row[4 * x + 3] = multiply_alpha (row[4 * x + 3], alphas[x]);
+}
+
 static void
 simple_multiply_alpha (GdkPixbuf *pixbuf,
                        guchar     alpha)
 {
   guchar *pixels;
+  guchar table[256];
   int rowstride;
-  int height;
-  int row;
+  int width, height;
+  int row, x;
 
   g_return_if_fail (GDK_IS_PIXBUF (pixbuf));
   
@@ -718,33 +746,24 @@ simple_multiply_alpha (GdkPixbuf *pixbuf,
   
   pixels = gdk_pixbuf_get_pixels (pixbuf);
   rowstride = gdk_pixbuf_get_rowstride (pixbuf);
+  width = gdk_pixbuf_get_width (pixbuf);
   height = gdk_pixbuf_get_height (pixbuf);
 
-  row = 0;
-  while (row < height)
-    {
-      guchar *p;
-      guchar *end;
-
-      p = pixels + row * rowstride;
-      end = p + rowstride;
+  /* multiply the two alpha channels. not sure this is right.
+   * but some end cases are that if the pixbuf contains 255,
+   * then it should be modified to contain "alpha"; if the
+   * pixbuf contains 0, it should remain 0.
+   */
+  /* ((*p / 255.0) * (alpha / 255.0)) * 255; */
+  for (x = 0; x < 256; x++)
+    table[x] = multiply_alpha (x, alpha);
 
-      while (p != end)
-        {
-          p += 3; /* skip RGB */
-
-          /* multiply the two alpha channels. not sure this is right.
-           * but some end cases are that if the pixbuf contains 255,
-           * then it should be modified to contain "alpha"; if the
-           * pixbuf contains 0, it should remain 0.
-           */
-          /* ((*p / 255.0) * (alpha / 255.0)) * 255; */
-          *p = (guchar) (((int) *p * (int) alpha) / (int) 255);
-          
-          ++p; /* skip A */
-        }
+  for (row = 0; row < height; row++)
+    {
+      guchar *p = pixels + row * rowstride;
 
-      ++row;
+      for (x = 0; x < width; x++)
+        p[4 * x + 3] = table[p[4 * x + 3]];
     }
 }
 
@@ -755,7 +774,6 @@ meta_gradient_add_alpha_horizontal (GdkPixbuf           *pixbuf,
 {
   int i, j;
   long a, da;
-  unsigned char *p;
   unsigned char *pixels;
   int width2;  
   int rowstride;
@@ -815,31 +833,8 @@ meta_gradient_add_alpha_horizontal (GdkPixbuf           *pixbuf,
   pixels = gdk_pixbuf_get_pixels (pixbuf);
   rowstride = gdk_pixbuf_get_rowstride (pixbuf);
   
-  p = pixels;
-  i = 0;
-  while (i < height)
-    {
-      unsigned char *row_end = p + rowstride;
-      gradient_p = gradient;
-
-      p += 3;
-      while (gradient_p != gradient_end)
-        {
-          /* multiply the two alpha channels. not sure this is right.
-           * but some end cases are that if the pixbuf contains 255,
-           * then it should be modified to contain "alpha"; if the
-           * pixbuf contains 0, it should remain 0.
-           */
-          /* ((*p / 255.0) * (alpha / 255.0)) * 255; */
-          *p = (guchar) (((int) *p * (int) *gradient_p) / (int) 255);
-
-          p += 4;
-          ++gradient_p;
-        }
-
-      p = row_end;
-      ++i;
-    }
+  for (i = 0; i < height; i++)
+    multiply_alpha_row (pixels + i * rowstride, gradient, width);
   
   g_free (gradient);
 }
@@ -855,8 +855,8 @@ static WnckWindowDisplayInfo
 meta_convert_meta_to_wnck (MetaWindow *window, MetaScreen *screen)
 {
   WnckWindowDisplayInfo wnck_window;
-  wnck_window.icon = window->icon;
-  wnck_window.mini_icon = window->mini_icon;
+  wnck_window.icon = meta_window_get_icon (window);
+  wnck_window.mini_icon = meta_window_get_mini_icon (window);
   wnck_window.is_active = window->has_focus;
 
   if (window->frame)
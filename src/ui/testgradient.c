@@ -20,8 +20,21 @@
  * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
  * 02111-1307, USA.  */
 
+/*
+ * Run without arguments, this shows a window for each kind of
+ * gradient. It can also be run as
+ *
+ *   testgradient --benchmark [ITERATIONS]
+ *   testgradient --check
+ *
+ * to time the gradient code, or to check the alpha gradients against
+ * a straightforward implementation ("make check" does the latter).
+ */
+
 #include <meta/gradient.h>
 #include <gtk/gtk.h>
+#include <stdlib.h>
+#include <string.h>
 
 typedef void (* RenderGradientFunc) (cairo_t     *cr,
                                      int          width,
@@ -77,9 +90,8 @@ draw_checkerboard (cairo_t *cr,
     }
 }
 
-static void
-render_simple (cairo_t     *cr,
-               int width, int height,
+static GdkPixbuf*
+create_simple (int width, int height,
                MetaGradientType type,
                gboolean    with_alpha)
 {
@@ -109,9 +121,23 @@ render_simple (cairo_t     *cr,
       meta_gradient_add_alpha (pixbuf,
                                alphas, G_N_ELEMENTS (alphas),
                                META_GRADIENT_HORIZONTAL);
-      
-      draw_checkerboard (cr , width, height);
     }
+
+  return pixbuf;
+}
+
+static void
+render_simple (cairo_t     *cr,
+               int width, int height,
+               MetaGradientType type,
+               gboolean    with_alpha)
+{
+  GdkPixbuf *pixbuf;
+
+  pixbuf = create_simple (width, height, type, with_alpha);
+
+  if (with_alpha)
+    draw_checkerboard (cr , width, height);
     
   gdk_cairo_set_source_pixbuf (cr, pixbuf, 0, 0);
   cairo_rectangle (cr, 0, 0, width, height);
@@ -148,12 +174,10 @@ render_diagonal_alpha_func (cairo_t *cr,
   render_simple (cr, width, height, META_GRADIENT_DIAGONAL, TRUE);
 }
 
-static void
-render_multi (cairo_t     *cr,
-              int width, int height,
+static GdkPixbuf*
+create_multi (int width, int height,
               MetaGradientType type)
 {
-  GdkPixbuf *pixbuf;
 #define N_COLORS 5
   GdkRGBA colors[N_COLORS];
 
@@ -163,16 +187,26 @@ render_multi (cairo_t     *cr,
   gdk_rgba_parse (&colors[3], "pink");
   gdk_rgba_parse (&colors[4], "green");
 
-  pixbuf = meta_gradient_create_multi (width, height,
-                                       colors, N_COLORS,
-                                       type);
+  return meta_gradient_create_multi (width, height,
+                                     colors, N_COLORS,
+                                     type);
+#undef N_COLORS
+}
+
+static void
+render_multi (cairo_t     *cr,
+              int width, int height,
+              MetaGradientType type)
+{
+  GdkPixbuf *pixbuf;
+
+  pixbuf = create_multi (width, height, type);
 
   gdk_cairo_set_source_pixbuf (cr, pixbuf, 0, 0);
   cairo_rectangle (cr, 0, 0, width, height);
   cairo_fill (cr);
 
   g_object_unref (G_OBJECT (pixbuf));
-#undef N_COLORS
 }
 
 static void
@@ -196,11 +230,9 @@ render_diagonal_multi_func (cairo_t *cr,
   render_multi (cr, width, height, META_GRADIENT_DIAGONAL);
 }
 
-static void
-render_interwoven_func (cairo_t *cr,
-                        int width, int height)
+static GdkPixbuf*
+create_interwoven (int width, int height)
 {
-  GdkPixbuf *pixbuf;
 #define N_COLORS 4
   GdkRGBA colors[N_COLORS];
 
@@ -209,9 +241,19 @@ render_interwoven_func (cairo_t *cr,
   gdk_rgba_parse (&colors[2], "pink");
   gdk_rgba_parse (&colors[3], "green");
 
-  pixbuf = meta_gradient_create_interwoven (width, height,
-                                            colors, height / 10,
-                                            colors + 2, height / 14);
+  return meta_gradient_create_interwoven (width, height,
+                                          colors, MAX (height / 10, 1),
+                                          colors + 2, MAX (height / 14, 1));
+#undef N_COLORS
+}
+
+static void
+render_interwoven_func (cairo_t *cr,
+                        int width, int height)
+{
+  GdkPixbuf *pixbuf;
+
+  pixbuf = create_interwoven (width, height);
 
   gdk_cairo_set_source_pixbuf (cr, pixbuf, 0, 0);
   cairo_rectangle (cr, 0, 0, width, height);
@@ -303,9 +345,246 @@ meta_gradient_test (void)
 
 }
 
+typedef enum
+{
+  GRADIENT_SIMPLE,
+  GRADIENT_SIMPLE_ALPHA,
+  GRADIENT_MULTI,
+  GRADIENT_INTERWOVEN
+} GradientKind;
+
+static const struct
+{
+  const char *name;
+  GradientKind kind;
+  MetaGradientType type;
+} gradients[] = {
+  { "simple-vertical", GRADIENT_SIMPLE, META_GRADIENT_VERTICAL },
+  { "simple-horizontal", GRADIENT_SIMPLE, META_GRADIENT_HORIZONTAL },
+  { "simple-diagonal", GRADIENT_SIMPLE, META_GRADIENT_DIAGONAL },
+  { "simple-vertical-alpha", GRADIENT_SIMPLE_ALPHA, META_GRADIENT_VERTICAL },
+  { "simple-diagonal-alpha", GRADIENT_SIMPLE_ALPHA, META_GRADIENT_DIAGONAL },
+  { "multi-vertical", GRADIENT_MULTI, META_GRADIENT_VERTICAL },
+  { "multi-horizontal", GRADIENT_MULTI, META_GRADIENT_HORIZONTAL },
+  { "multi-diagonal", GRADIENT_MULTI, META_GRADIENT_DIAGONAL },
+  { "interwoven", GRADIENT_INTERWOVEN, META_GRADIENT_LAST }
+};
+
+static GdkPixbuf*
+create_gradient (int i,
+                 int width,
+                 int height)
+{
+  switch (gradients[i].kind)
+    {
+    case GRADIENT_SIMPLE:
+      return create_simple (width, height, gradients[i].type, FALSE);
+    case GRADIENT_SIMPLE_ALPHA:
+      return create_simple (width, height, gradients[i].type, TRUE);
+    case GRADIENT_MULTI:
+      return create_multi (width, height, gradients[i].type);
+    case GRADIENT_INTERWOVEN:
+      return create_interwoven (width, height);
+    }
+
+  g_assert_not_reached ();
+  return NULL;
+}
+
+static int
+run_benchmark (int iterations)
+{
+  /* A titlebar, and the side of a frame */
+  const int sizes[][2] = { { 800, 24 }, { 6, 600 } };
+  int i, j, n;
+
+  for (i = 0; i < (int) G_N_ELEMENTS (gradients); i++)
+    {
+      for (j = 0; j < (int) G_N_ELEMENTS (sizes); j++)
+        {
+          gint64 start, elapsed;
+
+          start = g_get_monotonic_time ();
+
+          for (n = 0; n < iterations; n++)
+            g_object_unref (create_gradient (i, sizes[j][0], sizes[j][1]));
+
+          elapsed = g_get_monotonic_time () - start;
+
+          g_print ("%-24s %4dx%-4d %8.2f us\n",
+                   gradients[i].name, sizes[j][0], sizes[j][1],
+                   (double) elapsed / iterations);
+        }
+    }
+
+  return 0;
+}
+
+/* Checks the alpha multiply against the obvious way of doing it,
+ * for every combination of pixel and gradient alpha.
+ */
+static gboolean
+check_alpha_multiply (void)
+{
+  GdkPixbuf *pixbuf;
+  guchar *pixels;
+  int x, alpha;
+  gboolean ok;
+
+  pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8, 256, 1);
+  pixels = gdk_pixbuf_get_pixels (pixbuf);
+
+  ok = TRUE;
+  for (alpha = 0; alpha < 256 && ok; alpha++)
+    {
+      guchar alphas[1];
+
+      for (x = 0; x < 256; x++)
+        pixels[4 * x + 3] = x;
+
+      alphas[0] = alpha;
+      meta_gradient_add_alpha (pixbuf, alphas, 1, META_GRADIENT_HORIZONTAL);
+
+      for (x = 0; x < 256; x++)
+        {
+          if (pixels[4 * x + 3] != (x * alpha) / 255)
+            {
+              g_printerr ("Alpha %d multiplied by %d gave %d, expected %d\n",
+                          x, alpha, pixels[4 * x + 3], (x * alpha) / 255);
+              ok = FALSE;
+              break;
+            }
+        }
+    }
+
+  g_object_unref (pixbuf);
+
+  return ok;
+}
+
+/* The horizontal alpha gradient for alphas, worked out the same way
+ * as meta_gradient_add_alpha() does it
+ */
+static void
+reference_alpha_gradient (const guchar *alphas,
+                          int           n_alphas,
+                          int           width,
+                          guchar       *gradient)
+{
+  int width2, i, j, x;
+  long a, da;
+
+  if (n_alphas > width)
+    n_alphas = width;
+
+  width2 = width / (n_alphas - 1);
+
+  x = 0;
+  a = alphas[0] << 8;
+  for (i = 1; i < n_alphas; i++)
+    {
+      da = (((int) (alphas[i] - (int) alphas[i - 1])) << 8) / width2;
+
+      for (j = 0; j < width2; j++)
+        {
+          gradient[x++] = a >> 8;
+          a += da;
+        }
+
+      a = alphas[i] << 8;
+    }
+
+  while (x < width)
+    gradient[x++] = a >> 8;
+}
+
+/* Checks a multi-stop alpha gradient, which goes through the row
+ * kernel rather than the table, against the obvious multiply.
+ */
+static gboolean
+check_alpha_gradient (const guchar *alphas,
+                      int           n_alphas)
+{
+  /* Odd sizes, so that leftover pixels and row padding get exercised */
+  const int width = 301, height = 3;
+  GdkPixbuf *pixbuf;
+  guchar *pixels, *gradient;
+  int rowstride;
+  int x, row;
+  gboolean ok;
+
+  pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8, width, height);
+  pixels = gdk_pixbuf_get_pixels (pixbuf);
+  rowstride = gdk_pixbuf_get_rowstride (pixbuf);
+
+  for (row = 0; row < height; row++)
+    for (x = 0; x < width; x++)
+      pixels[row * rowstride + 4 * x + 3] = (x * 7 + row * 13) & 0xff;
+
+  meta_gradient_add_alpha (pixbuf, alphas, n_alphas, META_GRADIENT_HORIZONTAL);
+
+  gradient = g_new (guchar, width);
+  reference_alpha_gradient (alphas, n_alphas, width, gradient);
+
+  ok = TRUE;
+  for (row = 0; row < height && ok; row++)
+    {
+      for (x = 0; x < width; x++)
+        {
+          int original = (x * 7 + row * 13) & 0xff;
+          int expected = (original * gradient[x]) / 255;
+          int actual = pixels[row * rowstride + 4 * x + 3];
+
+          if (actual != expected)
+            {
+              g_printerr ("Alpha gradient with %d stops gave %d at %d,%d, expected %d\n",
+                          n_alphas, actual, x, row, expected);
+              ok = FALSE;
+              break;
+            }
+        }
+    }
+
+  g_free (gradient);
+  g_object_unref (pixbuf);
+
+  return ok;
+}
+
+static int
+run_checks (void)
+{
+  const guchar two_stops[] = { 0, 255 };
+  const guchar three_stops[] = { 255, 0, 128 };
+  const guchar five_stops[] = { 10, 200, 30, 255, 0 };
+  int failures;
+
+  failures = 0;
+
+  if (!check_alpha_multiply ())
+    failures++;
+  if (!check_alpha_gradient (two_stops, G_N_ELEMENTS (two_stops)))
+    failures++;
+  if (!check_alpha_gradient (three_stops, G_N_ELEMENTS (three_stops)))
+    failures++;
+  if (!check_alpha_gradient (five_stops, G_N_ELEMENTS (five_stops)))
+    failures++;
+
+  if (failures == 0)
+    g_print ("All tests passed.\n");
+
+  return failures > 0 ? 1 : 0;
+}
+
 int
 main (int argc, char **argv)
 {
+  if (argc > 1 && strcmp (argv[1], "--benchmark") == 0)
+    return run_benchmark (argc > 2 ? MAX (atoi (argv[2]), 1) : 1000);
+
+  if (argc > 1 && strcmp (argv[1], "--check") == 0)
+    return run_checks ();
+
   gtk_init (&argc, &argv);
 
   meta_gradient_test ();
@@ -314,4 +593,3 @@ main (int argc, char **argv)
 
   return 0;
 }
-
@@ -0,0 +1,522 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/* Mutter theme benchmark program */
+
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/*
+ * Loads a theme and draws a frame of it over and over into an image
+ * surface, reporting how long each draw took. Most of that time goes
+ * into evaluating the theme's position expressions, so this is the
+ * thing to run before and after touching that code.
+ *
+ * With --resize, it instead simulates an interactive resize, giving
+ * every step a new size, once with the frame drawn around the client
+ * area and once with the client area alone, to show what drawing the
+ * theme costs per resize step. Only the cairo drawing is timed; neither
+ * the X frame window nor the compositor's decoration canvases are
+ * involved.
+ *
+ * With --profile, it draws every frame type in a few states and at a
+ * few sizes, without the drawing caches, and ranks the frames, the draw
+ * op types and the theme's named draw op lists by the time spent in them.
+ *
+ * Usage: testtheme [--resize|--profile] [THEME] [ITERATIONS]
+ */
+
+#include "theme-private.h"
+#include <meta/util.h>
+#include <gtk/gtk.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CLIENT_WIDTH 600
+#define CLIENT_HEIGHT 400
+
+static void
+get_button_layout (MetaButtonLayout *layout)
+{
+  int i;
+
+  for (i = 0; i < MAX_BUTTONS_PER_CORNER; i++)
+    {
+      layout->left_buttons[i] = META_BUTTON_FUNCTION_LAST;
+      layout->left_buttons_has_spacer[i] = FALSE;
+      layout->right_buttons[i] = META_BUTTON_FUNCTION_LAST;
+      layout->right_buttons_has_spacer[i] = FALSE;
+    }
+
+  layout->left_buttons[0] = META_BUTTON_FUNCTION_MENU;
+
+  layout->right_buttons[0] = META_BUTTON_FUNCTION_MINIMIZE;
+  layout->right_buttons[1] = META_BUTTON_FUNCTION_MAXIMIZE;
+  layout->right_buttons[2] = META_BUTTON_FUNCTION_CLOSE;
+}
+
+static void
+run_benchmark (MetaTheme     *theme,
+               MetaFrameType  type,
+               MetaFrameFlags flags,
+               int            iterations)
+{
+  GtkStyleContext *style;
+  PangoContext *context;
+  PangoFontDescription *font_desc;
+  PangoLayout *layout;
+  MetaButtonLayout button_layout;
+  MetaButtonState button_states[META_BUTTON_TYPE_LAST];
+  MetaFrameBorders borders;
+  cairo_surface_t *surface;
+  cairo_t *cr;
+  int text_height;
+  gint64 start, elapsed;
+  int i;
+
+  style = meta_theme_create_style_context (gdk_screen_get_default (), NULL);
+
+  context = gdk_pango_context_get ();
+  font_desc = pango_font_description_from_string ("Sans Bold 10");
+  pango_font_description_set_size (font_desc,
+                                   MAX (pango_font_description_get_size (font_desc) *
+                                        meta_theme_get_title_scale (theme, type, flags), 1));
+  text_height = meta_pango_font_desc_get_text_height (font_desc, context);
+
+  layout = pango_layout_new (context);
+  pango_layout_set_font_description (layout, font_desc);
+  pango_layout_set_text (layout, "This is the title of a window", -1);
+
+  get_button_layout (&button_layout);
+  for (i = 0; i < META_BUTTON_TYPE_LAST; i++)
+    button_states[i] = META_BUTTON_STATE_NORMAL;
+
+  meta_theme_get_frame_borders (theme, type, text_height, flags, &borders);
+
+  surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+                                        CLIENT_WIDTH + borders.total.left + borders.total.right,
+                                        CLIENT_HEIGHT + borders.total.top + borders.total.bottom);
+  cr = cairo_create (surface);
+
+  start = g_get_monotonic_time ();
+
+  for (i = 0; i < iterations; i++)
+    meta_theme_draw_frame (theme, style, cr, type, flags,
+                           CLIENT_WIDTH, CLIENT_HEIGHT,
+                           layout, text_height,
+                           &button_layout, button_states,
+                           NULL, NULL);
+
+  elapsed = g_get_monotonic_time () - start;
+
+  g_print ("%d frames drawn in %g ms, %g us per frame\n",
+           iterations, elapsed / 1000.0, (double) elapsed / iterations);
+
+  cairo_destroy (cr);
+  cairo_surface_destroy (surface);
+  g_object_unref (layout);
+  pango_font_description_free (font_desc);
+  g_object_unref (context);
+  g_object_unref (style);
+}
+
+/* One step of a resize: a fresh surface of the new size, as a new
+ * pixmap would be, with the client area filled in and the frame drawn
+ * around it if there is a theme
+ */
+static void
+draw_resize_step (MetaTheme              *theme,
+                  GtkStyleContext        *style,
+                  PangoLayout            *layout,
+                  int                     text_height,
+                  const MetaButtonLayout *button_layout,
+                  MetaButtonState        *button_states,
+                  MetaFrameType           type,
+                  MetaFrameFlags          flags,
+                  int                     client_width,
+                  int                     client_height)
+{
+  MetaFrameGeometry fgeom;
+  cairo_surface_t *surface;
+  cairo_t *cr;
+  int x = 0, y = 0;
+  int width = client_width, height = client_height;
+
+  if (theme)
+    {
+      meta_theme_calc_geometry (theme, type, text_height, flags,
+                                client_width, client_height,
+                                button_layout, &fgeom);
+      x = fgeom.borders.total.left;
+      y = fgeom.borders.total.top;
+      width = fgeom.width;
+      height = fgeom.height;
+    }
+
+  surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, width, height);
+  cr = cairo_create (surface);
+
+  cairo_set_source_rgb (cr, 1.0, 1.0, 1.0);
+  cairo_rectangle (cr, x, y, client_width, client_height);
+  cairo_fill (cr);
+
+  if (theme)
+    meta_theme_draw_frame (theme, style, cr, type, flags,
+                           client_width, client_height,
+                           layout, text_height,
+                           button_layout, button_states,
+                           NULL, NULL);
+
+  cairo_destroy (cr);
+  cairo_surface_destroy (surface);
+}
+
+static void
+run_resize_benchmark (MetaTheme     *theme,
+                      MetaFrameType  type,
+                      MetaFrameFlags flags,
+                      int            iterations)
+{
+  GtkStyleContext *style;
+  PangoContext *context;
+  PangoFontDescription *font_desc;
+  PangoLayout *layout;
+  MetaButtonLayout button_layout;
+  MetaButtonState button_states[META_BUTTON_TYPE_LAST];
+  int text_height;
+  gint64 start, elapsed[2];
+  int pass, i;
+
+  style = meta_theme_create_style_context (gdk_screen_get_default (), NULL);
+
+  context = gdk_pango_context_get ();
+  font_desc = pango_font_description_from_string ("Sans Bold 10");
+  text_height = meta_pango_font_desc_get_text_height (font_desc, context);
+
+  layout = pango_layout_new (context);
+  pango_layout_set_font_description (layout, font_desc);
+  pango_layout_set_text (layout, "This is the title of a window", -1);
+
+  get_button_layout (&button_layout);
+  for (i = 0; i < META_BUTTON_TYPE_LAST; i++)
+    button_states[i] = META_BUTTON_STATE_NORMAL;
+
+  /* Pass 0 with decorations, pass 1 without */
+  for (pass = 0; pass < 2; pass++)
+    {
+      start = g_get_monotonic_time ();
+
+      for (i = 0; i < iterations; i++)
+        draw_resize_step (pass == 0 ? theme : NULL, style, layout,
+                          text_height, &button_layout, button_states,
+                          type, flags,
+                          CLIENT_WIDTH / 2 + (i * 7) % CLIENT_WIDTH,
+                          CLIENT_HEIGHT / 2 + (i * 5) % CLIENT_HEIGHT);
+
+      elapsed[pass] = MAX (g_get_monotonic_time () - start, 1);
+    }
+
+  g_print ("Decorations on:  %d resize steps in %g ms, %g steps per second\n",
+           iterations, elapsed[0] / 1000.0,
+           iterations * (double) G_USEC_PER_SEC / elapsed[0]);
+  g_print ("Decorations off: %d resize steps in %g ms, %g steps per second\n",
+           iterations, elapsed[1] / 1000.0,
+           iterations * (double) G_USEC_PER_SEC / elapsed[1]);
+
+  g_object_unref (layout);
+  pango_font_description_free (font_desc);
+  g_object_unref (context);
+  g_object_unref (style);
+}
+
+typedef struct
+{
+  char *label;
+  guint calls;
+  gint64 total_ns;
+} ProfileRow;
+
+static void
+profile_row_free (ProfileRow *row)
+{
+  g_free (row->label);
+  g_free (row);
+}
+
+static void
+add_profile_row (GPtrArray  *rows,
+                 char       *label,
+                 guint       calls,
+                 gint64      total_ns)
+{
+  ProfileRow *row;
+
+  row = g_new (ProfileRow, 1);
+  row->label = label;
+  row->calls = calls;
+  row->total_ns = total_ns;
+
+  g_ptr_array_add (rows, row);
+}
+
+static int
+compare_profile_rows (gconstpointer a,
+                      gconstpointer b)
+{
+  const ProfileRow *row_a = *(const ProfileRow **) a;
+  const ProfileRow *row_b = *(const ProfileRow **) b;
+
+  if (row_a->total_ns != row_b->total_ns)
+    return row_a->total_ns < row_b->total_ns ? 1 : -1;
+
+  return strcmp (row_a->label, row_b->label);
+}
+
+static void
+print_profile_rows (const char *title,
+                    GPtrArray  *rows)
+{
+  guint i;
+
+  g_ptr_array_sort (rows, compare_profile_rows);
+
+  g_print ("\n%s\n", title);
+  g_print ("%12s %10s %12s  %s\n", "total ms", "calls", "us per call", "name");
+
+  for (i = 0; i < rows->len; i++)
+    {
+      ProfileRow *row = g_ptr_array_index (rows, i);
+
+      g_print ("%12.3f %10u %12.3f  %s\n",
+               row->total_ns / 1e6, row->calls,
+               row->calls ? row->total_ns / 1e3 / row->calls : 0.0,
+               row->label);
+    }
+}
+
+static void
+run_profile (MetaTheme *theme,
+             int        iterations)
+{
+  static const struct { int width, height; } sizes[] = {
+    { 200, 100 }, { CLIENT_WIDTH, CLIENT_HEIGHT }, { 1600, 1000 }
+  };
+  static const struct { const char *name; MetaFrameFlags flags; } states[] = {
+    { "focused", META_FRAME_HAS_FOCUS },
+    { "unfocused", 0 },
+    { "maximized", META_FRAME_HAS_FOCUS | META_FRAME_MAXIMIZED }
+  };
+  MetaFrameFlags base_flags;
+  GtkStyleContext *style;
+  PangoContext *context;
+  PangoFontDescription *font_desc;
+  PangoLayout *layout;
+  MetaButtonLayout button_layout;
+  MetaButtonState button_states[META_BUTTON_TYPE_LAST];
+  GPtrArray *rows;
+  GHashTableIter iter;
+  gpointer key, value;
+  int text_height;
+  int type, state, size, i;
+
+  base_flags = META_FRAME_ALLOWS_DELETE | META_FRAME_ALLOWS_MENU |
+               META_FRAME_ALLOWS_MINIMIZE | META_FRAME_ALLOWS_MAXIMIZE |
+               META_FRAME_ALLOWS_VERTICAL_RESIZE |
+               META_FRAME_ALLOWS_HORIZONTAL_RESIZE |
+               META_FRAME_ALLOWS_SHADE | META_FRAME_ALLOWS_MOVE;
+
+  style = meta_theme_create_style_context (gdk_screen_get_default (), NULL);
+
+  context = gdk_pango_context_get ();
+  font_desc = pango_font_description_from_string ("Sans Bold 10");
+  text_height = meta_pango_font_desc_get_text_height (font_desc, context);
+
+  layout = pango_layout_new (context);
+  pango_layout_set_font_description (layout, font_desc);
+  pango_layout_set_text (layout, "This is the title of a window", -1);
+
+  get_button_layout (&button_layout);
+  for (i = 0; i < META_BUTTON_TYPE_LAST; i++)
+    button_states[i] = META_BUTTON_STATE_NORMAL;
+
+  rows = g_ptr_array_new_with_free_func ((GDestroyNotify) profile_row_free);
+
+  meta_draw_profile_start ();
+
+  for (type = 0; type < META_FRAME_TYPE_LAST; type++)
+    for (state = 0; state < (int) G_N_ELEMENTS (states); state++)
+      for (size = 0; size < (int) G_N_ELEMENTS (sizes); size++)
+        {
+          MetaFrameFlags flags = base_flags | states[state].flags;
+          MetaFrameBorders borders;
+          cairo_surface_t *surface;
+          cairo_t *cr;
+          gint64 start, elapsed;
+
+          if (meta_theme_get_frame_style (theme, type, flags) == NULL)
+            continue;
+
+          meta_theme_get_frame_borders (theme, type, text_height, flags, &borders);
+
+          surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+                                                sizes[size].width + borders.total.left + borders.total.right,
+                                                sizes[size].height + borders.total.top + borders.total.bottom);
+          cr = cairo_create (surface);
+
+          start = g_get_monotonic_time ();
+
+          for (i = 0; i < iterations; i++)
+            {
+              /* Measure drawing the theme, not reusing what was drawn */
+              meta_theme_clear_piece_cache (theme);
+
+              meta_theme_draw_frame (theme, style, cr, type, flags,
+                                     sizes[size].width, sizes[size].height,
+                                     layout, text_height,
+                                     &button_layout, button_states,
+                                     NULL, NULL);
+            }
+
+          elapsed = g_get_monotonic_time () - start;
+
+          add_profile_row (rows,
+                           g_strdup_printf ("%s %s %dx%d",
+                                            meta_frame_type_to_string (type),
+                                            states[state].name,
+                                            sizes[size].width,
+                                            sizes[size].height),
+                           iterations, elapsed * 1000);
+
+          cairo_destroy (cr);
+          cairo_surface_destroy (surface);
+        }
+
+  print_profile_rows ("Frames", rows);
+  g_ptr_array_set_size (rows, 0);
+
+  for (i = 0; i <= META_DRAW_TILE; i++)
+    {
+      const MetaDrawProfileEntry *entry = meta_draw_profile_get_op_type (i);
+
+      if (entry->calls > 0)
+        add_profile_row (rows, g_strdup (meta_draw_type_to_string (i)),
+                         entry->calls, entry->total_ns);
+    }
+
+  print_profile_rows ("Draw ops, including nested ones", rows);
+  g_ptr_array_set_size (rows, 0);
+
+  g_hash_table_iter_init (&iter, theme->draw_op_lists_by_name);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+      const MetaDrawProfileEntry *entry = meta_draw_profile_get_op_list (value);
+
+      if (entry != NULL)
+        add_profile_row (rows, g_strdup (key), entry->calls, entry->total_ns);
+    }
+
+  print_profile_rows ("Named draw op lists, including nested ones", rows);
+
+  meta_draw_profile_stop ();
+
+  g_ptr_array_free (rows, TRUE);
+  g_object_unref (layout);
+  pango_font_description_free (font_desc);
+  g_object_unref (context);
+  g_object_unref (style);
+}
+
+int
+main (int argc, char **argv)
+{
+  MetaTheme *theme;
+  const char *theme_name;
+  int iterations;
+  gboolean resize = FALSE;
+  gboolean profile = FALSE;
+  MetaFrameFlags flags;
+  GError *error = NULL;
+
+  gtk_init (&argc, &argv);
+
+  if (argc > 1 && strcmp (argv[1], "--resize") == 0)
+    resize = TRUE;
+  else if (argc > 1 && strcmp (argv[1], "--profile") == 0)
+    profile = TRUE;
+
+  if (resize || profile)
+    {
+      argc--;
+      argv++;
+    }
+
+  theme_name = argc > 1 ? argv[1] : "Default";
+  iterations = argc > 2 ? atoi (argv[2]) : (profile ? 100 : 1000);
+
+  if (iterations <= 0)
+    {
+      g_printerr ("Number of iterations must be positive\n");
+      return 1;
+    }
+
+  if (profile)
+    {
+      /* Not the current theme, so the image cache stays out of it */
+      theme = meta_theme_load (theme_name, &error);
+      if (theme == NULL)
+        {
+          g_printerr ("Failed to load theme \"%s\": %s\n",
+                      theme_name, error->message);
+          g_error_free (error);
+          return 1;
+        }
+
+      g_print ("Profiling theme \"%s\", %d draws per frame\n",
+               theme_name, iterations);
+
+      run_profile (theme, iterations);
+
+      meta_theme_free (theme);
+      return 0;
+    }
+
+  /* Make it the current theme, since drawing only uses the theme's
+   * caches for the current one
+   */
+  meta_theme_set_current (theme_name);
+  theme = meta_theme_get_current ();
+  if (theme == NULL)
+    {
+      g_printerr ("Failed to load theme \"%s\"\n", theme_name);
+      return 1;
+    }
+
+  g_print ("Loaded theme \"%s\"\n", theme_name);
+
+  flags = META_FRAME_ALLOWS_DELETE | META_FRAME_ALLOWS_MENU |
+          META_FRAME_ALLOWS_MINIMIZE | META_FRAME_ALLOWS_MAXIMIZE |
+          META_FRAME_ALLOWS_VERTICAL_RESIZE |
+          META_FRAME_ALLOWS_HORIZONTAL_RESIZE |
+          META_FRAME_HAS_FOCUS | META_FRAME_ALLOWS_SHADE |
+          META_FRAME_ALLOWS_MOVE;
+
+  if (resize)
+    run_resize_benchmark (theme, META_FRAME_TYPE_NORMAL, flags, iterations);
+  else
+    run_benchmark (theme, META_FRAME_TYPE_NORMAL, flags, iterations);
+
+  return 0;
+}
@@ -4192,6 +4192,7 @@ load_theme (const char *theme_dir,
   gsize length;
   char *theme_filename;
   char *theme_file;
+  gint64 mtime;
   MetaTheme *retval;
 
   g_return_val_if_fail (error && *error == NULL, NULL);
@@ -4203,6 +4204,11 @@ load_theme (const char *theme_dir,
   theme_filename = g_strdup_printf (METACITY_THEME_FILENAME_FORMAT, major_version);
   theme_file = g_build_filename (theme_dir, theme_filename, NULL);
 
+  /* Before reading, so that a change made while we parse is noticed
+   * next time
+   */
+  mtime = meta_theme_get_file_mtime (theme_file);
+
   if (!g_file_get_contents (theme_file,
                             &text,
                             &length,
@@ -4232,6 +4238,7 @@ load_theme (const char *theme_dir,
     goto out;
 
   retval = info.theme;
+  retval->mtime = mtime;
   info.theme = NULL;
 
  out:
@@ -4266,6 +4273,93 @@ keep_trying (GError **error)
   return FALSE;
 }
 
+/* The directories a theme called theme_name is looked for in, in
+ * order: XDG_USER_DATA_DIR, XDG_DATA_DIRS, then the system dir.
+ * Free with g_strfreev().
+ */
+static char **
+get_theme_dirs (const char *theme_name)
+{
+  const gchar* const* xdg_data_dirs;
+  GPtrArray *dirs;
+  int i;
+
+  dirs = g_ptr_array_new ();
+
+  g_ptr_array_add (dirs, g_build_filename (g_get_user_data_dir (),
+                                           "themes",
+                                           theme_name,
+                                           THEME_SUBDIR,
+                                           NULL));
+
+  xdg_data_dirs = g_get_system_data_dirs ();
+  for (i = 0; xdg_data_dirs[i] != NULL; i++)
+    g_ptr_array_add (dirs, g_build_filename (xdg_data_dirs[i],
+                                             "themes",
+                                             theme_name,
+                                             THEME_SUBDIR,
+                                             NULL));
+
+  g_ptr_array_add (dirs, g_build_filename (MUTTER_DATADIR,
+                                           "themes",
+                                           theme_name,
+                                           THEME_SUBDIR,
+                                           NULL));
+
+  g_ptr_array_add (dirs, NULL);
+
+  return (char **) g_ptr_array_free (dirs, FALSE);
+}
+
+/**
+ * meta_theme_find_file: (skip)
+ * @theme_name: the name of a theme
+ *
+ * Looks for the file of a theme the way meta_theme_load() does, without
+ * parsing anything: the first file that exists, trying all supported
+ * major versions from current to oldest, and each directory in order
+ * for each of them. meta_theme_load() would go past a file it can't
+ * read or that is too old for its version, so the result may differ
+ * from the file it loads in those cases.
+ *
+ * Return value: the path of the file, or %NULL if there is none
+ */
+char*
+meta_theme_find_file (const char *theme_name)
+{
+  char **theme_dirs;
+  char *theme_filename;
+  char *theme_file = NULL;
+  int major_version;
+  int i;
+
+  theme_dirs = get_theme_dirs (theme_name);
+
+  for (major_version = THEME_MAJOR_VERSION; (major_version > 0); major_version--)
+    {
+      theme_filename = g_strdup_printf (METACITY_THEME_FILENAME_FORMAT, major_version);
+
+      for (i = 0; theme_dirs[i] != NULL; i++)
+        {
+          theme_file = g_build_filename (theme_dirs[i], theme_filename, NULL);
+          if (g_file_test (theme_file, G_FILE_TEST_IS_REGULAR))
+            break;
+
+          g_free (theme_file);
+          theme_file = NULL;
+        }
+
+      g_free (theme_filename);
+
+      if (theme_file)
+        break;
+    }
+
+  g_strfreev (theme_dirs);
+
+  return theme_file;
+}
+
 /**
  * meta_theme_load: (skip)
  * @theme_name: 
@@ -4277,61 +4371,28 @@ meta_theme_load (const char *theme_name,
                  GError    **err)
 {
   GError *error = NULL;
-  char *theme_dir;
+  char **theme_dirs;
   MetaTheme *retval;
-  const gchar* const* xdg_data_dirs;
   int major_version;
   int i;
 
   retval = NULL;
+  theme_dirs = get_theme_dirs (theme_name);
   
   /* We try all supported major versions from current to oldest */
   for (major_version = THEME_MAJOR_VERSION; (major_version > 0); major_version--)
     {
-      /* We try first in XDG_USER_DATA_DIR, XDG_DATA_DIRS, then system dir for themes */
-
-      /* Try XDG_USER_DATA_DIR first */
-      theme_dir = g_build_filename (g_get_user_data_dir(),
-                                    "themes",
-                                    theme_name,
-                                    THEME_SUBDIR,
-                                    NULL);
-
-      retval = load_theme (theme_dir, theme_name, major_version, &error);
-      g_free (theme_dir);
-      if (!keep_trying (&error))
-        goto out;
-
-      /* Try each XDG_DATA_DIRS for theme */
-      xdg_data_dirs = g_get_system_data_dirs();
-      for(i = 0; xdg_data_dirs[i] != NULL; i++)
+      for (i = 0; theme_dirs[i] != NULL; i++)
         {
-          theme_dir = g_build_filename (xdg_data_dirs[i],
-                                        "themes",
-                                        theme_name,
-                                        THEME_SUBDIR,
-                                        NULL);
-
-          retval = load_theme (theme_dir, theme_name, major_version, &error);
-          g_free (theme_dir);
+          retval = load_theme (theme_dirs[i], theme_name, major_version, &error);
           if (!keep_trying (&error))
             goto out;
         }
-
-      /* Look for themes in MUTTER_DATADIR */
-      theme_dir = g_build_filename (MUTTER_DATADIR,
-                                    "themes",
-                                    theme_name,
-                                    THEME_SUBDIR,
-                                    NULL);
-
-      retval = load_theme (theme_dir, theme_name, major_version, &error);
-      g_free (theme_dir);
-      if (!keep_trying (&error))
-        goto out;
     }
 
  out:
+  g_strfreev (theme_dirs);
+
   if (!error && !retval)
     g_set_error (&error, META_THEME_ERROR, META_THEME_ERROR_FAILED,
                  _("Failed to find a valid file for theme %s\n"),
@@ -441,13 +441,65 @@ typedef struct
   } d;
 } PosToken;
 
+/**
+ * The variables an expression can refer to; see #MetaPositionExprEnv.
+ */
+typedef enum
+{
+  POS_VAR_WIDTH,
+  POS_VAR_HEIGHT,
+  POS_VAR_OBJECT_WIDTH,
+  POS_VAR_OBJECT_HEIGHT,
+  POS_VAR_LEFT_WIDTH,
+  POS_VAR_RIGHT_WIDTH,
+  POS_VAR_TOP_HEIGHT,
+  POS_VAR_BOTTOM_HEIGHT,
+  POS_VAR_MINI_ICON_WIDTH,
+  POS_VAR_MINI_ICON_HEIGHT,
+  POS_VAR_ICON_WIDTH,
+  POS_VAR_ICON_HEIGHT,
+  POS_VAR_TITLE_WIDTH,
+  POS_VAR_TITLE_HEIGHT,
+  POS_VAR_FRAME_X_CENTER,
+  POS_VAR_FRAME_Y_CENTER,
+  POS_VAR_LAST
+} PosVariable;
+
+typedef enum
+{
+  POS_INSTR_INT,
+  POS_INSTR_DOUBLE,
+  POS_INSTR_VARIABLE,
+  POS_INSTR_OPERATOR
+} PosInstrType;
+
+/**
+ * One instruction of a compiled expression. Expressions are compiled
+ * to postfix order: constants and variables push a value, operators
+ * pop two and push the result.
+ *
+ * \ingroup parser
+ */
+typedef struct
+{
+  PosInstrType type;
+
+  union
+  {
+    int int_val;
+    double double_val;
+    PosVariable var;
+    PosOperatorType op;
+  } d;
+} PosInstr;
+
 /**
  * MetaDrawSpec: (skip)
  *
  * A computed expression in our simple vector drawing language.
  * While it appears to take the form of a tree, this is actually
- * merely a list; concerns such as precedence of operators are
- * currently recomputed on every recalculation.
+ * merely a list; it is compiled once into postfix code, so
+ * precedence of operators is only worked out at theme load.
  *
  * Created by meta_draw_spec_new(), destroyed by meta_draw_spec_free().
  * pos_eval() fills this with ...FIXME. Are tokens a tree or a list?
@@ -468,6 +520,16 @@ struct _MetaDrawSpec
   /** How many tokens are in the tokens list. */
   int n_tokens;
 
+  /**
+   * The tokens compiled to postfix, with variables resolved and
+   * constant subexpressions folded; %NULL if the expression couldn't
+   * be compiled, in which case the tokens are evaluated directly.
+   */
+  PosInstr *code;
+
+  /** How many instructions are in the code list. */
+  int n_code;
+
   /** Does the expression contain any variables? */
   gboolean constant : 1;
 };
@@ -635,6 +697,13 @@ struct _MetaDrawOpList
   MetaDrawOp **ops;
   int n_ops;
   int n_allocated;
+
+  /* Whether the list draws the same thing for a given size wherever
+   * it is in the frame, so its output can be kept in the piece cache.
+   * Worked out the first time the list is drawn.
+   */
+  unsigned int cacheable_known : 1;
+  unsigned int cacheable : 1;
 };
 
 typedef enum
@@ -843,6 +912,11 @@ struct _MetaTheme
    * \bug Kept lying around for no discernable reason.
    */
   char *filename;
+  /**
+   * Modification time of the theme file when it was loaded, in
+   * microseconds; see meta_theme_get_file_mtime().
+   */
+  gint64 mtime;
   /** Metadata: Human-readable name of the theme. */
   char *readable_name;
   /** Metadata: Author of the theme. */
@@ -869,12 +943,34 @@ struct _MetaTheme
    * */
   GHashTable *color_constants;
   GHashTable *images_by_filename;
+  /**
+   * Modification times of the image files loaded from the theme
+   * directory, by full path, as pointers to gint64.
+   */
+  GHashTable *image_mtimes;
   GHashTable *layouts_by_name;
   GHashTable *draw_op_lists_by_name;
   GHashTable *styles_by_name;
   GHashTable *style_sets_by_name;
   MetaFrameStyleSet *style_sets_by_type[META_FRAME_TYPE_LAST];
 
+  /**
+   * Rendered frame pieces and buttons, keyed by draw op list, GTK+
+   * style context and size. Only small pieces whose drawing doesn't
+   * depend on the rest of the frame are kept; see
+   * meta_theme_clear_piece_cache().
+   */
+  GHashTable *piece_cache;
+
+  /**
+   * Scaled, colorized and alpha-blended images ready to be painted,
+   * in least recently used order, with a table to find them and
+   * their total size in bytes.
+   */
+  GHashTable *image_cache;
+  GQueue image_cache_lru;
+  gsize image_cache_size;
+
   GQuark quark_width;
   GQuark quark_height;
   GQuark quark_object_width;
@@ -979,6 +1075,24 @@ gboolean       meta_draw_op_list_validate (MetaDrawOpList    *op_list,
 gboolean       meta_draw_op_list_contains (MetaDrawOpList    *op_list,
                                            MetaDrawOpList    *child);
 
+/**
+ * MetaDrawProfileEntry: (skip)
+ *
+ * Cumulative cost of a draw op type or a draw op list while profiling;
+ * times include nested ops and lists.
+ */
+typedef struct
+{
+  guint  calls;
+  gint64 total_ns;
+} MetaDrawProfileEntry;
+
+void        meta_draw_profile_start (void);
+void        meta_draw_profile_stop  (void);
+const MetaDrawProfileEntry *meta_draw_profile_get_op_type (MetaDrawType          type);
+const MetaDrawProfileEntry *meta_draw_profile_get_op_list (const MetaDrawOpList *op_list);
+const char *meta_draw_type_to_string (MetaDrawType type);
+
 MetaGradientSpec* meta_gradient_spec_new    (MetaGradientType        type);
 void              meta_gradient_spec_free   (MetaGradientSpec       *desc);
 GdkPixbuf*        meta_gradient_spec_render (const MetaGradientSpec *desc,
@@ -1014,6 +1128,9 @@ GdkPixbuf* meta_theme_load_image (MetaTheme  *theme,
                                   guint       size_of_theme_icons,
                                   GError    **error);
 
+gint64     meta_theme_get_file_mtime (const char *filename);
+char*      meta_theme_find_file      (const char *theme_name);
+
 MetaFrameStyle* meta_theme_get_frame_style (MetaTheme     *theme,
                                             MetaFrameType  type,
                                             MetaFrameFlags flags);
@@ -1025,6 +1142,8 @@ double meta_theme_get_title_scale (MetaTheme     *theme,
 GtkStyleContext * meta_theme_create_style_context (GdkScreen   *screen,
                                                    const gchar *variant);
 
+void meta_theme_clear_piece_cache (MetaTheme *theme);
+
 void meta_theme_draw_frame (MetaTheme              *theme,
                             GtkStyleContext        *style_gtk,
                             cairo_t                *cr,
@@ -45,6 +45,7 @@
 #include <gtk/gtk.h>
 #include <string.h>
 #include <stdlib.h>
+#include <time.h>
 #include <math.h>
 
 #define GDK_COLOR_RGBA(color)                                           \
@@ -2459,9 +2460,10 @@ pos_eval_get_variable (PosToken                  *t,
  * Evaluates a sequence of tokens within a particular environment context,
  * and returns the current value. May recur if parantheses are found.
  *
- * FIXME: Yes, we really do reparse the expression every time it's evaluated.
- *        We should keep the parse tree around all the time and just
- *        run the new values through it.
+ * This is the slow path: expressions are normally compiled by
+ * pos_compile() when the theme is loaded, and only come here if
+ * that wasn't possible or if the compiled code failed, so that we
+ * can report what went wrong.
  */
 static gboolean
 pos_eval_helper (PosToken                   *tokens,
@@ -2618,6 +2620,391 @@ pos_eval_helper (PosToken                   *tokens,
   return TRUE;
 }
 
+static const char * const pos_variable_names[POS_VAR_LAST] = {
+  "width",
+  "height",
+  "object_width",
+  "object_height",
+  "left_width",
+  "right_width",
+  "top_height",
+  "bottom_height",
+  "mini_icon_width",
+  "mini_icon_height",
+  "icon_width",
+  "icon_height",
+  "title_width",
+  "title_height",
+  "frame_x_center",
+  "frame_y_center"
+};
+
+static int
+pos_op_precedence (PosOperatorType op)
+{
+  switch (op)
+    {
+    case POS_OP_MULTIPLY:
+    case POS_OP_DIVIDE:
+    case POS_OP_MOD:
+      return 2;
+    case POS_OP_ADD:
+    case POS_OP_SUBTRACT:
+      return 1;
+    case POS_OP_MAX:
+    case POS_OP_MIN:
+    case POS_OP_NONE:
+      break;
+    }
+
+  return 0;
+}
+
+static void
+pos_emit_operator (PosInstr        *code,
+                   int             *n_code,
+                   PosOperatorType  op)
+{
+  PosInstr *a, *b;
+  PosExpr lhs, rhs;
+
+  /* If both operands are constants, fold them now. Anything that
+   * would fail (division by zero, say) is left for pos_eval to
+   * report, just as it always has.
+   */
+  if (*n_code >= 2)
+    {
+      a = &code[*n_code - 2];
+      b = &code[*n_code - 1];
+
+      if ((a->type == POS_INSTR_INT || a->type == POS_INSTR_DOUBLE) &&
+          (b->type == POS_INSTR_INT || b->type == POS_INSTR_DOUBLE))
+        {
+          if (a->type == POS_INSTR_INT)
+            {
+              lhs.type = POS_EXPR_INT;
+              lhs.d.int_val = a->d.int_val;
+            }
+          else
+            {
+              lhs.type = POS_EXPR_DOUBLE;
+              lhs.d.double_val = a->d.double_val;
+            }
+
+          if (b->type == POS_INSTR_INT)
+            {
+              rhs.type = POS_EXPR_INT;
+              rhs.d.int_val = b->d.int_val;
+            }
+          else
+            {
+              rhs.type = POS_EXPR_DOUBLE;
+              rhs.d.double_val = b->d.double_val;
+            }
+
+          if (do_operation (&lhs, &rhs, op, NULL))
+            {
+              if (lhs.type == POS_EXPR_INT)
+                {
+                  a->type = POS_INSTR_INT;
+                  a->d.int_val = lhs.d.int_val;
+                }
+              else
+                {
+                  a->type = POS_INSTR_DOUBLE;
+                  a->d.double_val = lhs.d.double_val;
+                }
+
+              *n_code -= 1;
+              return;
+            }
+        }
+    }
+
+  code[*n_code].type = POS_INSTR_OPERATOR;
+  code[*n_code].d.op = op;
+  *n_code += 1;
+}
+
+/**
+ * pos_compile:
+ * @spec: The expression to compile
+ *
+ * Compiles the tokens of @spec into postfix code, so that evaluating
+ * it doesn't have to deal with parentheses, precedence and variable
+ * names every time a frame is drawn.
+ *
+ * Only well-formed expressions that pos_eval_helper() would evaluate
+ * without complaint are compiled; for anything else the tokens are
+ * kept as the only representation, so the same errors are still
+ * reported at evaluation time.
+ */
+static void
+pos_compile (MetaDrawSpec *spec)
+{
+  PosInstr *code;
+  int n_code;
+  PosOperatorType *ops;
+  int *n_exprs;
+  int n_ops;
+  int depth;
+  gboolean expect_operand;
+  int stack_depth, max_stack_depth;
+  int i, j;
+
+  spec->code = NULL;
+  spec->n_code = 0;
+
+  if (spec->n_tokens == 0)
+    return;
+
+  code = g_new (PosInstr, spec->n_tokens);
+  n_code = 0;
+
+  /* Operator stack for the shunting-yard; an open paren is pushed
+   * as POS_OP_NONE.
+   */
+  ops = g_new (PosOperatorType, spec->n_tokens);
+  n_ops = 0;
+
+  /* Number of operands and operators at each paren level, to refuse
+   * the same expressions pos_eval_helper() can't fit in MAX_EXPRS.
+   */
+  n_exprs = g_new0 (int, spec->n_tokens + 1);
+  depth = 0;
+
+  expect_operand = TRUE;
+
+  for (i = 0; i < spec->n_tokens; i++)
+    {
+      PosToken *t = &spec->tokens[i];
+
+      switch (t->type)
+        {
+        case POS_TOKEN_INT:
+        case POS_TOKEN_DOUBLE:
+        case POS_TOKEN_VARIABLE:
+          if (!expect_operand)
+            goto fail;
+
+          if (t->type == POS_TOKEN_INT)
+            {
+              code[n_code].type = POS_INSTR_INT;
+              code[n_code].d.int_val = t->d.i.val;
+            }
+          else if (t->type == POS_TOKEN_DOUBLE)
+            {
+              code[n_code].type = POS_INSTR_DOUBLE;
+              code[n_code].d.double_val = t->d.d.val;
+            }
+          else
+            {
+              for (j = 0; j < POS_VAR_LAST; j++)
+                if (strcmp (t->d.v.name, pos_variable_names[j]) == 0)
+                  break;
+
+              if (j == POS_VAR_LAST)
+                goto fail;
+
+              code[n_code].type = POS_INSTR_VARIABLE;
+              code[n_code].d.var = j;
+            }
+
+          ++n_code;
+          ++n_exprs[depth];
+          expect_operand = FALSE;
+          break;
+
+        case POS_TOKEN_OPERATOR:
+          if (expect_operand)
+            goto fail;
+
+          while (n_ops > 0 &&
+                 ops[n_ops - 1] != POS_OP_NONE &&
+                 pos_op_precedence (ops[n_ops - 1]) >= pos_op_precedence (t->d.o.op))
+            pos_emit_operator (code, &n_code, ops[--n_ops]);
+
+          ops[n_ops++] = t->d.o.op;
+          ++n_exprs[depth];
+          expect_operand = TRUE;
+          break;
+
+        case POS_TOKEN_OPEN_PAREN:
+          if (!expect_operand)
+            goto fail;
+
+          ops[n_ops++] = POS_OP_NONE;
+          ++n_exprs[depth];
+          ++depth;
+          n_exprs[depth] = 0;
+          break;
+
+        case POS_TOKEN_CLOSE_PAREN:
+          if (expect_operand || depth == 0)
+            goto fail;
+
+          while (ops[n_ops - 1] != POS_OP_NONE)
+            pos_emit_operator (code, &n_code, ops[--n_ops]);
+          --n_ops;
+
+          --depth;
+          break;
+        }
+
+      if (n_exprs[depth] >= MAX_EXPRS)
+        goto fail;
+    }
+
+  if (expect_operand || depth != 0)
+    goto fail;
+
+  while (n_ops > 0)
+    pos_emit_operator (code, &n_code, ops[--n_ops]);
+
+  /* The evaluation stack is a fixed-size array too */
+  stack_depth = 0;
+  max_stack_depth = 0;
+  for (i = 0; i < n_code; i++)
+    {
+      if (code[i].type == POS_INSTR_OPERATOR)
+        --stack_depth;
+      else
+        ++stack_depth;
+
+      max_stack_depth = MAX (max_stack_depth, stack_depth);
+    }
+
+  if (max_stack_depth > MAX_EXPRS)
+    goto fail;
+
+  spec->code = g_renew (PosInstr, code, n_code);
+  spec->n_code = n_code;
+
+  g_free (ops);
+  g_free (n_exprs);
+  return;
+
+ fail:
+  g_free (code);
+  g_free (ops);
+  g_free (n_exprs);
+}
+
+/* Runs code compiled by pos_compile(). This doesn't report errors;
+ * when it fails, pos_eval() evaluates the tokens again to get exactly
+ * the error the theme author has always seen.
+ */
+static gboolean
+pos_eval_code (const PosInstr            *code,
+               int                        n_code,
+               const MetaPositionExprEnv *env,
+               PosExpr                   *result)
+{
+  PosExpr stack[MAX_EXPRS];
+  int n_stack;
+  int i;
+
+  n_stack = 0;
+  for (i = 0; i < n_code; i++)
+    {
+      const PosInstr *instr = &code[i];
+      PosExpr *top = &stack[n_stack];
+
+      switch (instr->type)
+        {
+        case POS_INSTR_INT:
+          top->type = POS_EXPR_INT;
+          top->d.int_val = instr->d.int_val;
+          ++n_stack;
+          break;
+
+        case POS_INSTR_DOUBLE:
+          top->type = POS_EXPR_DOUBLE;
+          top->d.double_val = instr->d.double_val;
+          ++n_stack;
+          break;
+
+        case POS_INSTR_VARIABLE:
+          top->type = POS_EXPR_INT;
+
+          switch (instr->d.var)
+            {
+            case POS_VAR_WIDTH:
+              top->d.int_val = env->rect.width;
+              break;
+            case POS_VAR_HEIGHT:
+              top->d.int_val = env->rect.height;
+              break;
+            case POS_VAR_OBJECT_WIDTH:
+              if (env->object_width < 0)
+                return FALSE;
+              top->d.int_val = env->object_width;
+              break;
+            case POS_VAR_OBJECT_HEIGHT:
+              if (env->object_height < 0)
+                return FALSE;
+              top->d.int_val = env->object_height;
+              break;
+            case POS_VAR_LEFT_WIDTH:
+              top->d.int_val = env->left_width;
+              break;
+            case POS_VAR_RIGHT_WIDTH:
+              top->d.int_val = env->right_width;
+              break;
+            case POS_VAR_TOP_HEIGHT:
+              top->d.int_val = env->top_height;
+              break;
+            case POS_VAR_BOTTOM_HEIGHT:
+              top->d.int_val = env->bottom_height;
+              break;
+            case POS_VAR_MINI_ICON_WIDTH:
+              top->d.int_val = env->mini_icon_width;
+              break;
+            case POS_VAR_MINI_ICON_HEIGHT:
+              top->d.int_val = env->mini_icon_height;
+              break;
+            case POS_VAR_ICON_WIDTH:
+              top->d.int_val = env->icon_width;
+              break;
+            case POS_VAR_ICON_HEIGHT:
+              top->d.int_val = env->icon_height;
+              break;
+            case POS_VAR_TITLE_WIDTH:
+              top->d.int_val = env->title_width;
+              break;
+            case POS_VAR_TITLE_HEIGHT:
+              top->d.int_val = env->title_height;
+              break;
+            case POS_VAR_FRAME_X_CENTER:
+              top->d.int_val = env->frame_x_center;
+              break;
+            case POS_VAR_FRAME_Y_CENTER:
+              top->d.int_val = env->frame_y_center;
+              break;
+            case POS_VAR_LAST:
+              g_assert_not_reached ();
+              break;
+            }
+
+          ++n_stack;
+          break;
+
+        case POS_INSTR_OPERATOR:
+          if (!do_operation (&stack[n_stack - 2], &stack[n_stack - 1],
+                             instr->d.op, NULL))
+            return FALSE;
+          --n_stack;
+          break;
+        }
+    }
+
+  g_assert (n_stack == 1);
+
+  *result = stack[0];
+
+  return TRUE;
+}
+
 /*
  *   expr = int | double | expr * expr | expr / expr |
  *          expr + expr | expr - expr | (expr)
@@ -2651,7 +3038,9 @@ pos_eval (MetaDrawSpec              *spec,
 
   *val_p = 0;
 
-  if (pos_eval_helper (spec->tokens, spec->n_tokens, env, &expr, err))
+  if ((spec->code != NULL &&
+       pos_eval_code (spec->code, spec->n_code, env, &expr)) ||
+      pos_eval_helper (spec->tokens, spec->n_tokens, env, &expr, err))
     {
       switch (expr.type)
         {
@@ -2865,6 +3254,7 @@ meta_draw_spec_free (MetaDrawSpec *spec)
 {
   if (!spec) return;
   free_tokens (spec->tokens, spec->n_tokens);
+  g_free (spec->code);
   g_slice_free (MetaDrawSpec, spec);
 }
 
@@ -2896,6 +3286,8 @@ meta_draw_spec_new (MetaTheme  *theme,
           return NULL;
         }
     }
+  else
+    pos_compile (spec);
     
   return spec;
 }
@@ -3611,6 +4003,392 @@ fill_env (MetaPositionExprEnv *env,
 }
 
 
+/* Total size of the images a theme keeps ready to paint */
+#define MAX_IMAGE_CACHE_SIZE (4 * 1024 * 1024)
+
+typedef struct
+{
+  GdkPixbuf *source;
+  int width;
+  int height;
+  MetaImageFillType fill_type;
+  guint vertical_stripes : 1;
+  guint horizontal_stripes : 1;
+  guint colorized : 1;
+  guint32 colorize_pixel;
+  MetaGradientType alpha_type;
+  int n_alphas;
+  guchar *alphas;
+} ImageCacheKey;
+
+typedef struct
+{
+  ImageCacheKey key;
+  cairo_surface_t *surface;
+  gsize size;
+  GList link;
+} ImageCacheEntry;
+
+static guint
+image_cache_key_hash (gconstpointer v)
+{
+  const ImageCacheKey *key = v;
+
+  return g_direct_hash (key->source) ^ (key->width << 16) ^ key->height ^
+    key->colorize_pixel;
+}
+
+static gboolean
+image_cache_key_equal (gconstpointer a,
+                       gconstpointer b)
+{
+  const ImageCacheKey *key_a = a;
+  const ImageCacheKey *key_b = b;
+
+  return key_a->source == key_b->source &&
+    key_a->width == key_b->width &&
+    key_a->height == key_b->height &&
+    key_a->fill_type == key_b->fill_type &&
+    key_a->vertical_stripes == key_b->vertical_stripes &&
+    key_a->horizontal_stripes == key_b->horizontal_stripes &&
+    key_a->colorized == key_b->colorized &&
+    key_a->colorize_pixel == key_b->colorize_pixel &&
+    key_a->alpha_type == key_b->alpha_type &&
+    key_a->n_alphas == key_b->n_alphas &&
+    memcmp (key_a->alphas, key_b->alphas, key_a->n_alphas) == 0;
+}
+
+static void
+image_cache_entry_free (gpointer data)
+{
+  ImageCacheEntry *entry = data;
+
+  g_object_unref (entry->key.source);
+  g_free (entry->key.alphas);
+  cairo_surface_destroy (entry->surface);
+  g_slice_free (ImageCacheEntry, entry);
+}
+
+static void
+image_cache_remove (MetaTheme       *theme,
+                    ImageCacheEntry *entry)
+{
+  g_queue_unlink (&theme->image_cache_lru, &entry->link);
+  theme->image_cache_size -= entry->size;
+  g_hash_table_remove (theme->image_cache, &entry->key);
+}
+
+static void
+image_cache_clear (MetaTheme *theme)
+{
+  if (theme->image_cache == NULL)
+    return;
+
+  while (theme->image_cache_lru.tail)
+    image_cache_remove (theme, theme->image_cache_lru.tail->data);
+}
+
+/* Paints @pixbuf stretched to @width x @height without going through
+ * an intermediate pixbuf. Only used when scaling up, which cairo's
+ * bilinear filter does the same way as gdk_pixbuf_scale_simple().
+ */
+static cairo_surface_t*
+scale_pixbuf_to_surface (GdkPixbuf *pixbuf,
+                         int        width,
+                         int        height)
+{
+  cairo_surface_t *surface;
+  cairo_t *cr;
+
+  surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, width, height);
+  cr = cairo_create (surface);
+
+  cairo_scale (cr,
+               (double) width / gdk_pixbuf_get_width (pixbuf),
+               (double) height / gdk_pixbuf_get_height (pixbuf));
+  gdk_cairo_set_source_pixbuf (cr, pixbuf, 0, 0);
+  cairo_pattern_set_filter (cairo_get_source (cr), CAIRO_FILTER_BILINEAR);
+  cairo_pattern_set_extend (cairo_get_source (cr), CAIRO_EXTEND_PAD);
+  cairo_paint (cr);
+
+  cairo_destroy (cr);
+
+  return surface;
+}
+
+static cairo_surface_t*
+pixbuf_to_surface (GdkPixbuf *pixbuf)
+{
+  cairo_surface_t *surface;
+  cairo_t *cr;
+
+  surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+                                        gdk_pixbuf_get_width (pixbuf),
+                                        gdk_pixbuf_get_height (pixbuf));
+  cr = cairo_create (surface);
+
+  gdk_cairo_set_source_pixbuf (cr, pixbuf, 0, 0);
+  cairo_paint (cr);
+
+  cairo_destroy (cr);
+
+  return surface;
+}
+
+/**
+ * image_surface_for_op:
+ * @op: An image or icon draw op
+ * @style_gtk: The style context to render colors with
+ * @info: The draw info, for the window icons
+ * @theme: The theme that keeps the cache
+ * @width: Width to draw the image at
+ * @height: Height to draw the image at
+ *
+ * Returns the image @op draws, ready to paint at the given size. The
+ * result is kept in a per-theme cache, keyed by everything that goes
+ * into producing it, so that the scaling, tiling, colorizing and alpha
+ * steps and the conversion from #GdkPixbuf only happen once.
+ *
+ * Returns: (transfer none): A surface, or %NULL if @op draws nothing
+ */
+static cairo_surface_t*
+image_surface_for_op (const MetaDrawOp    *op,
+                      GtkStyleContext     *style_gtk,
+                      const MetaDrawInfo  *info,
+                      MetaTheme           *theme,
+                      int                  width,
+                      int                  height)
+{
+  ImageCacheKey key;
+  ImageCacheEntry *entry;
+  MetaAlphaGradientSpec *alpha_spec;
+  GdkPixbuf *pixbuf;
+  gboolean needs_alpha;
+
+  memset (&key, 0, sizeof (key));
+
+  if (op->type == META_DRAW_IMAGE)
+    {
+      key.source = op->data.image.pixbuf;
+      key.fill_type = op->data.image.fill_type;
+      key.vertical_stripes = op->data.image.vertical_stripes;
+      key.horizontal_stripes = op->data.image.horizontal_stripes;
+      alpha_spec = op->data.image.alpha_spec;
+
+      if (op->data.image.colorize_spec)
+        {
+          GdkRGBA color;
+
+          meta_color_spec_render (op->data.image.colorize_spec,
+                                  style_gtk, &color);
+
+          key.colorized = TRUE;
+          key.colorize_pixel = GDK_COLOR_RGB (color);
+        }
+    }
+  else
+    {
+      g_assert (op->type == META_DRAW_ICON);
+
+      /* Same choice as draw_op_as_pixbuf() */
+      if (info->mini_icon &&
+          width <= gdk_pixbuf_get_width (info->mini_icon) &&
+          height <= gdk_pixbuf_get_height (info->mini_icon))
+        key.source = info->mini_icon;
+      else
+        key.source = info->icon;
+
+      key.fill_type = op->data.icon.fill_type;
+      alpha_spec = op->data.icon.alpha_spec;
+    }
+
+  if (key.source == NULL || width <= 0 || height <= 0)
+    return NULL;
+
+  key.width = width;
+  key.height = height;
+
+  if (alpha_spec)
+    {
+      key.alpha_type = alpha_spec->type;
+      key.n_alphas = alpha_spec->n_alphas;
+      key.alphas = alpha_spec->alphas;
+    }
+
+  if (theme->image_cache == NULL)
+    theme->image_cache = g_hash_table_new_full (image_cache_key_hash,
+                                                image_cache_key_equal,
+                                                NULL,
+                                                image_cache_entry_free);
+
+  entry = g_hash_table_lookup (theme->image_cache, &key);
+  if (entry)
+    {
+      g_queue_unlink (&theme->image_cache_lru, &entry->link);
+      g_queue_push_head_link (&theme->image_cache_lru, &entry->link);
+
+      return entry->surface;
+    }
+
+  needs_alpha = alpha_spec && (alpha_spec->n_alphas > 1 ||
+                               alpha_spec->alphas[0] != 0xff);
+
+  entry = g_slice_new0 (ImageCacheEntry);
+
+  if (key.fill_type == META_IMAGE_FILL_SCALE &&
+      !key.colorized && !needs_alpha &&
+      !key.vertical_stripes && !key.horizontal_stripes &&
+      width >= gdk_pixbuf_get_width (key.source) &&
+      height >= gdk_pixbuf_get_height (key.source))
+    {
+      entry->surface = scale_pixbuf_to_surface (key.source, width, height);
+    }
+  else
+    {
+      pixbuf = draw_op_as_pixbuf (op, style_gtk, info, width, height);
+      if (pixbuf == NULL)
+        {
+          g_slice_free (ImageCacheEntry, entry);
+          return NULL;
+        }
+
+      entry->surface = pixbuf_to_surface (pixbuf);
+      g_object_unref (G_OBJECT (pixbuf));
+    }
+
+  entry->key = key;
+  entry->key.alphas = g_memdup (key.alphas, key.n_alphas);
+  g_object_ref (entry->key.source);
+  entry->size = cairo_image_surface_get_stride (entry->surface) *
+    cairo_image_surface_get_height (entry->surface);
+  entry->link.data = entry;
+
+  g_hash_table_insert (theme->image_cache, &entry->key, entry);
+  g_queue_push_head_link (&theme->image_cache_lru, &entry->link);
+  theme->image_cache_size += entry->size;
+
+  /* Never evict what we just added, even if it is too big by itself */
+  while (theme->image_cache_size > MAX_IMAGE_CACHE_SIZE &&
+         theme->image_cache_lru.tail != &entry->link)
+    image_cache_remove (theme, theme->image_cache_lru.tail->data);
+
+  return entry->surface;
+}
+
+/* Cumulative draw times for the theme profiler, NULL unless it is
+ * running; see meta_draw_profile_start()
+ */
+typedef struct
+{
+  MetaDrawProfileEntry op_types[META_DRAW_TILE + 1];
+  GHashTable *op_lists;
+} DrawProfile;
+
+static DrawProfile *draw_profile = NULL;
+
+static gint64
+draw_profile_now (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+
+  return (gint64) ts.tv_sec * G_GINT64_CONSTANT (1000000000) + ts.tv_nsec;
+}
+
+static void
+draw_profile_record (MetaDrawProfileEntry *entry,
+                     gint64                start)
+{
+  entry->calls++;
+  entry->total_ns += draw_profile_now () - start;
+}
+
+/**
+ * meta_draw_profile_start: (skip)
+ *
+ * Starts recording how many times each draw op type and draw op list is
+ * drawn and how long that takes, throwing away anything recorded so far.
+ */
+void
+meta_draw_profile_start (void)
+{
+  meta_draw_profile_stop ();
+
+  draw_profile = g_new0 (DrawProfile, 1);
+  draw_profile->op_lists =
+    g_hash_table_new_full (NULL, NULL,
+                           (GDestroyNotify) meta_draw_op_list_unref, g_free);
+}
+
+/**
+ * meta_draw_profile_stop: (skip)
+ *
+ * Stops profiling and frees what was recorded.
+ */
+void
+meta_draw_profile_stop (void)
+{
+  if (draw_profile == NULL)
+    return;
+
+  g_hash_table_destroy (draw_profile->op_lists);
+  g_free (draw_profile);
+  draw_profile = NULL;
+}
+
+/**
+ * meta_draw_profile_get_op_type: (skip)
+ * @type: a draw op type
+ *
+ * Return value: what was recorded for @type, or %NULL if the profiler
+ *   isn't running
+ */
+const MetaDrawProfileEntry *
+meta_draw_profile_get_op_type (MetaDrawType type)
+{
+  g_return_val_if_fail (type <= META_DRAW_TILE, NULL);
+
+  if (draw_profile == NULL)
+    return NULL;
+
+  return &draw_profile->op_types[type];
+}
+
+/**
+ * meta_draw_profile_get_op_list: (skip)
+ * @op_list: a draw op list
+ *
+ * Return value: what was recorded for @op_list, or %NULL if it wasn't
+ *   drawn or the profiler isn't running
+ */
+const MetaDrawProfileEntry *
+meta_draw_profile_get_op_list (const MetaDrawOpList *op_list)
+{
+  if (draw_profile == NULL)
+    return NULL;
+
+  return g_hash_table_lookup (draw_profile->op_lists, op_list);
+}
+
+static MetaDrawProfileEntry *
+draw_profile_op_list_entry (const MetaDrawOpList *op_list)
+{
+  MetaDrawProfileEntry *entry;
+
+  entry = g_hash_table_lookup (draw_profile->op_lists, op_list);
+  if (entry == NULL)
+    {
+      /* Keep the list alive so its address can't be reused */
+      meta_draw_op_list_ref ((MetaDrawOpList *) op_list);
+
+      entry = g_new0 (MetaDrawProfileEntry, 1);
+      g_hash_table_insert (draw_profile->op_lists, (gpointer) op_list, entry);
+    }
+
+  return entry;
+}
+
 /* This code was originally rendering anti-aliased using X primitives, and
  * now has been switched to draw anti-aliased using cairo. In general, the
  * closest correspondence between X rendering and cairo rendering is given
@@ -3623,12 +4401,12 @@ fill_env (MetaPositionExprEnv *env,
  * fuzz around the edges.
  */
 static void
-meta_draw_op_draw_with_env (const MetaDrawOp    *op,
-                            GtkStyleContext     *style_gtk,
-                            cairo_t             *cr,
-                            const MetaDrawInfo  *info,
-                            MetaRectangle        rect,
-                            MetaPositionExprEnv *env)
+draw_op_with_env (const MetaDrawOp    *op,
+                  GtkStyleContext     *style_gtk,
+                  cairo_t             *cr,
+                  const MetaDrawInfo  *info,
+                  MetaRectangle        rect,
+                  MetaPositionExprEnv *env)
 {
   GdkRGBA color;
 
@@ -3863,8 +4641,25 @@ meta_draw_op_draw_with_env (const MetaDrawOp    *op,
             env->object_height = gdk_pixbuf_get_height (op->data.image.pixbuf);
           }
 
-        rwidth = parse_size_unchecked (op->data.image.width, env);
-        rheight = parse_size_unchecked (op->data.image.height, env);
+        rwidth = parse_size_unchecked (op->data.image.width, env);
+        rheight = parse_size_unchecked (op->data.image.height, env);
+
+        if (env->theme)
+          {
+            cairo_surface_t *surface;
+
+            surface = image_surface_for_op (op, style_gtk, info, env->theme,
+                                            rwidth, rheight);
+            if (surface)
+              {
+                rx = parse_x_position_unchecked (op->data.image.x, env);
+                ry = parse_y_position_unchecked (op->data.image.y, env);
+
+                cairo_set_source_surface (cr, surface, rx, ry);
+                cairo_paint (cr);
+              }
+            break;
+          }
         
         pixbuf = draw_op_as_pixbuf (op, style_gtk, info,
                                     rwidth, rheight);
@@ -3952,6 +4747,23 @@ meta_draw_op_draw_with_env (const MetaDrawOp    *op,
 
         rwidth = parse_size_unchecked (op->data.icon.width, env);
         rheight = parse_size_unchecked (op->data.icon.height, env);
+
+        if (env->theme)
+          {
+            cairo_surface_t *surface;
+
+            surface = image_surface_for_op (op, style_gtk, info, env->theme,
+                                            rwidth, rheight);
+            if (surface)
+              {
+                rx = parse_x_position_unchecked (op->data.icon.x, env);
+                ry = parse_y_position_unchecked (op->data.icon.y, env);
+
+                cairo_set_source_surface (cr, surface, rx, ry);
+                cairo_paint (cr);
+              }
+            break;
+          }
         
         pixbuf = draw_op_as_pixbuf (op, style_gtk, info,
                                     rwidth, rheight);
@@ -4090,6 +4902,27 @@ meta_draw_op_draw_with_env (const MetaDrawOp    *op,
   gtk_style_context_restore (style_gtk);
 }
 
+static void
+meta_draw_op_draw_with_env (const MetaDrawOp    *op,
+                            GtkStyleContext     *style_gtk,
+                            cairo_t             *cr,
+                            const MetaDrawInfo  *info,
+                            MetaRectangle        rect,
+                            MetaPositionExprEnv *env)
+{
+  gint64 start;
+
+  if (G_LIKELY (draw_profile == NULL))
+    {
+      draw_op_with_env (op, style_gtk, cr, info, rect, env);
+      return;
+    }
+
+  start = draw_profile_now ();
+  draw_op_with_env (op, style_gtk, cr, info, rect, env);
+  draw_profile_record (&draw_profile->op_types[op->type], start);
+}
+
 void
 meta_draw_op_draw_with_style (const MetaDrawOp    *op,
                               GtkStyleContext     *style_gtk,
@@ -4124,6 +4957,8 @@ meta_draw_op_list_new (int n_preallocs)
   op_list->n_allocated = n_preallocs;
   op_list->ops = g_new (MetaDrawOp*, op_list->n_allocated);
   op_list->n_ops = 0;
+  op_list->cacheable_known = FALSE;
+  op_list->cacheable = FALSE;
 
   return op_list;
 }
@@ -4158,12 +4993,12 @@ meta_draw_op_list_unref (MetaDrawOpList *op_list)
     }
 }
 
-void
-meta_draw_op_list_draw_with_style  (const MetaDrawOpList *op_list,
-                                    GtkStyleContext      *style_gtk,
-                                    cairo_t              *cr,
-                                    const MetaDrawInfo   *info,
-                                    MetaRectangle         rect)
+static void
+draw_op_list_with_style (const MetaDrawOpList *op_list,
+                         GtkStyleContext      *style_gtk,
+                         cairo_t              *cr,
+                         const MetaDrawInfo   *info,
+                         MetaRectangle         rect)
 {
   int i;
   MetaPositionExprEnv env;
@@ -4216,6 +5051,26 @@ meta_draw_op_list_draw_with_style  (const MetaDrawOpList *op_list,
   cairo_restore (cr);
 }
 
+void
+meta_draw_op_list_draw_with_style  (const MetaDrawOpList *op_list,
+                                    GtkStyleContext      *style_gtk,
+                                    cairo_t              *cr,
+                                    const MetaDrawInfo   *info,
+                                    MetaRectangle         rect)
+{
+  gint64 start;
+
+  if (G_LIKELY (draw_profile == NULL))
+    {
+      draw_op_list_with_style (op_list, style_gtk, cr, info, rect);
+      return;
+    }
+
+  start = draw_profile_now ();
+  draw_op_list_with_style (op_list, style_gtk, cr, info, rect);
+  draw_profile_record (draw_profile_op_list_entry (op_list), start);
+}
+
 void
 meta_draw_op_list_append (MetaDrawOpList       *op_list,
                           MetaDrawOp           *op)
@@ -4228,6 +5083,7 @@ meta_draw_op_list_append (MetaDrawOpList       *op_list,
 
   op_list->ops[op_list->n_ops] = op;
   op_list->n_ops += 1;
+  op_list->cacheable_known = FALSE;
 }
 
 gboolean
@@ -4595,8 +5451,292 @@ button_rect (MetaButtonType           type,
     }
 }
 
+/* Pieces bigger than this are usually stretched along an edge of the
+ * frame, so they change size on every step of an interactive resize
+ * and there's nothing to gain from keeping them.
+ */
+#define MAX_CACHED_PIECE_AREA (96 * 96)
+#define MAX_CACHED_PIECES 128
+
+typedef struct
+{
+  MetaDrawOpList *op_list;
+  GtkStyleContext *style_gtk;
+  int width;
+  int height;
+} PieceCacheKey;
+
+static guint
+piece_cache_key_hash (gconstpointer v)
+{
+  const PieceCacheKey *key = v;
+
+  return g_direct_hash (key->op_list) ^ g_direct_hash (key->style_gtk) ^
+    (key->width << 16) ^ key->height;
+}
+
+static gboolean
+piece_cache_key_equal (gconstpointer a,
+                       gconstpointer b)
+{
+  const PieceCacheKey *key_a = a;
+  const PieceCacheKey *key_b = b;
+
+  return key_a->op_list == key_b->op_list &&
+    key_a->style_gtk == key_b->style_gtk &&
+    key_a->width == key_b->width &&
+    key_a->height == key_b->height;
+}
+
+static void
+piece_cache_key_free (gpointer data)
+{
+  PieceCacheKey *key = data;
+
+  meta_draw_op_list_unref (key->op_list);
+  g_object_unref (key->style_gtk);
+  g_slice_free (PieceCacheKey, key);
+}
+
+/* An expression can only be cached if it doesn't use any of the
+ * variables that describe the frame around the piece being drawn.
+ */
+static gboolean
+draw_spec_is_cacheable (const MetaDrawSpec *spec)
+{
+  int i;
+
+  if (spec == NULL || spec->constant)
+    return TRUE;
+
+  if (spec->code == NULL)
+    return FALSE;
+
+  for (i = 0; i < spec->n_code; i++)
+    {
+      if (spec->code[i].type != POS_INSTR_VARIABLE)
+        continue;
+
+      switch (spec->code[i].d.var)
+        {
+        case POS_VAR_WIDTH:
+        case POS_VAR_HEIGHT:
+        case POS_VAR_OBJECT_WIDTH:
+        case POS_VAR_OBJECT_HEIGHT:
+          break;
+        default:
+          return FALSE;
+        }
+    }
+
+  return TRUE;
+}
+
+static gboolean draw_op_list_is_cacheable (MetaDrawOpList *op_list);
+
+static gboolean
+draw_op_is_cacheable (const MetaDrawOp *op)
+{
+  switch (op->type)
+    {
+    case META_DRAW_LINE:
+      return draw_spec_is_cacheable (op->data.line.x1) &&
+        draw_spec_is_cacheable (op->data.line.y1) &&
+        draw_spec_is_cacheable (op->data.line.x2) &&
+        draw_spec_is_cacheable (op->data.line.y2);
+
+    case META_DRAW_RECTANGLE:
+      return draw_spec_is_cacheable (op->data.rectangle.x) &&
+        draw_spec_is_cacheable (op->data.rectangle.y) &&
+        draw_spec_is_cacheable (op->data.rectangle.width) &&
+        draw_spec_is_cacheable (op->data.rectangle.height);
+
+    case META_DRAW_ARC:
+      return draw_spec_is_cacheable (op->data.arc.x) &&
+        draw_spec_is_cacheable (op->data.arc.y) &&
+        draw_spec_is_cacheable (op->data.arc.width) &&
+        draw_spec_is_cacheable (op->data.arc.height);
+
+    case META_DRAW_CLIP:
+      return draw_spec_is_cacheable (op->data.clip.x) &&
+        draw_spec_is_cacheable (op->data.clip.y) &&
+        draw_spec_is_cacheable (op->data.clip.width) &&
+        draw_spec_is_cacheable (op->data.clip.height);
+
+    case META_DRAW_TINT:
+      return draw_spec_is_cacheable (op->data.tint.x) &&
+        draw_spec_is_cacheable (op->data.tint.y) &&
+        draw_spec_is_cacheable (op->data.tint.width) &&
+        draw_spec_is_cacheable (op->data.tint.height);
+
+    case META_DRAW_GRADIENT:
+      return draw_spec_is_cacheable (op->data.gradient.x) &&
+        draw_spec_is_cacheable (op->data.gradient.y) &&
+        draw_spec_is_cacheable (op->data.gradient.width) &&
+        draw_spec_is_cacheable (op->data.gradient.height);
+
+    case META_DRAW_IMAGE:
+      return draw_spec_is_cacheable (op->data.image.x) &&
+        draw_spec_is_cacheable (op->data.image.y) &&
+        draw_spec_is_cacheable (op->data.image.width) &&
+        draw_spec_is_cacheable (op->data.image.height);
+
+    case META_DRAW_GTK_ARROW:
+      return draw_spec_is_cacheable (op->data.gtk_arrow.x) &&
+        draw_spec_is_cacheable (op->data.gtk_arrow.y) &&
+        draw_spec_is_cacheable (op->data.gtk_arrow.width) &&
+        draw_spec_is_cacheable (op->data.gtk_arrow.height);
+
+    case META_DRAW_GTK_BOX:
+      return draw_spec_is_cacheable (op->data.gtk_box.x) &&
+        draw_spec_is_cacheable (op->data.gtk_box.y) &&
+        draw_spec_is_cacheable (op->data.gtk_box.width) &&
+        draw_spec_is_cacheable (op->data.gtk_box.height);
+
+    case META_DRAW_GTK_VLINE:
+      return draw_spec_is_cacheable (op->data.gtk_vline.x) &&
+        draw_spec_is_cacheable (op->data.gtk_vline.y1) &&
+        draw_spec_is_cacheable (op->data.gtk_vline.y2);
+
+    case META_DRAW_ICON:
+    case META_DRAW_TITLE:
+      /* These depend on the window */
+      return FALSE;
+
+    case META_DRAW_OP_LIST:
+      return draw_spec_is_cacheable (op->data.op_list.x) &&
+        draw_spec_is_cacheable (op->data.op_list.y) &&
+        draw_spec_is_cacheable (op->data.op_list.width) &&
+        draw_spec_is_cacheable (op->data.op_list.height) &&
+        draw_op_list_is_cacheable (op->data.op_list.op_list);
+
+    case META_DRAW_TILE:
+      return draw_spec_is_cacheable (op->data.tile.x) &&
+        draw_spec_is_cacheable (op->data.tile.y) &&
+        draw_spec_is_cacheable (op->data.tile.width) &&
+        draw_spec_is_cacheable (op->data.tile.height) &&
+        draw_spec_is_cacheable (op->data.tile.tile_xoffset) &&
+        draw_spec_is_cacheable (op->data.tile.tile_yoffset) &&
+        draw_spec_is_cacheable (op->data.tile.tile_width) &&
+        draw_spec_is_cacheable (op->data.tile.tile_height) &&
+        draw_op_list_is_cacheable (op->data.tile.op_list);
+    }
+
+  return FALSE;
+}
+
+static gboolean
+draw_op_list_is_cacheable (MetaDrawOpList *op_list)
+{
+  int i;
+
+  if (!op_list->cacheable_known)
+    {
+      op_list->cacheable = TRUE;
+      for (i = 0; i < op_list->n_ops && op_list->cacheable; i++)
+        op_list->cacheable = draw_op_is_cacheable (op_list->ops[i]);
+
+      op_list->cacheable_known = TRUE;
+    }
+
+  return op_list->cacheable;
+}
+
+/**
+ * meta_theme_clear_piece_cache: (skip)
+ * @theme: a #MetaTheme
+ *
+ * Drops all the frame pieces @theme has rendered. This must be called
+ * when the GTK+ style contexts used to draw frames change, since they
+ * provide some of the colors.
+ */
+void
+meta_theme_clear_piece_cache (MetaTheme *theme)
+{
+  if (theme->piece_cache)
+    g_hash_table_remove_all (theme->piece_cache);
+}
+
+/* Draws @op_list into @rect, reusing what it drew last time at the
+ * same size if it's a small piece that doesn't depend on the rest of
+ * the frame. The caller must already have clipped @cr to @rect.
+ */
+static void
+draw_op_list_cached (MetaTheme          *theme,
+                     MetaDrawOpList     *op_list,
+                     GtkStyleContext    *style_gtk,
+                     cairo_t            *cr,
+                     const MetaDrawInfo *info,
+                     const GdkRectangle *rect)
+{
+  PieceCacheKey key;
+  cairo_surface_t *surface;
+
+  if (theme == NULL ||
+      rect->width <= 0 || rect->height <= 0 ||
+      rect->width * rect->height > MAX_CACHED_PIECE_AREA ||
+      !draw_op_list_is_cacheable (op_list))
+    {
+      meta_draw_op_list_draw_with_style (op_list,
+                                         style_gtk,
+                                         cr,
+                                         info,
+                                         meta_rect (rect->x, rect->y,
+                                                    rect->width, rect->height));
+      return;
+    }
+
+  if (theme->piece_cache == NULL)
+    theme->piece_cache = g_hash_table_new_full (piece_cache_key_hash,
+                                                piece_cache_key_equal,
+                                                piece_cache_key_free,
+                                                (GDestroyNotify) cairo_surface_destroy);
+
+  key.op_list = op_list;
+  key.style_gtk = style_gtk;
+  key.width = rect->width;
+  key.height = rect->height;
+
+  surface = g_hash_table_lookup (theme->piece_cache, &key);
+  if (surface == NULL)
+    {
+      PieceCacheKey *new_key;
+      cairo_t *piece_cr;
+
+      /* This only fills up if the theme is drawn at lots of different
+       * sizes, in which case starting over is as good as anything.
+       */
+      if (g_hash_table_size (theme->piece_cache) >= MAX_CACHED_PIECES)
+        g_hash_table_remove_all (theme->piece_cache);
+
+      surface = cairo_surface_create_similar (cairo_get_target (cr),
+                                              CAIRO_CONTENT_COLOR_ALPHA,
+                                              rect->width, rect->height);
+
+      piece_cr = cairo_create (surface);
+      meta_draw_op_list_draw_with_style (op_list,
+                                         style_gtk,
+                                         piece_cr,
+                                         info,
+                                         meta_rect (0, 0,
+                                                    rect->width, rect->height));
+      cairo_destroy (piece_cr);
+
+      new_key = g_slice_new (PieceCacheKey);
+      *new_key = key;
+      meta_draw_op_list_ref (op_list);
+      g_object_ref (style_gtk);
+
+      g_hash_table_insert (theme->piece_cache, new_key, surface);
+    }
+
+  cairo_set_source_surface (cr, surface, rect->x, rect->y);
+  cairo_paint (cr);
+}
+
 static void
-meta_frame_style_draw_with_style (MetaFrameStyle          *style,
+meta_frame_style_draw_with_style (MetaTheme               *theme,
+                                  MetaFrameStyle          *style,
                                   GtkStyleContext         *style_gtk,
                                   cairo_t                 *cr,
                                   const MetaFrameGeometry *fgeom,
@@ -4762,15 +5902,8 @@ meta_frame_style_draw_with_style (MetaFrameStyle          *style,
             }
 
           if (op_list)
-            {
-              MetaRectangle m_rect;
-              m_rect = meta_rect (rect.x, rect.y, rect.width, rect.height);
-              meta_draw_op_list_draw_with_style (op_list,
-                                                 style_gtk,
-                                                 cr,
-                                                 &draw_info,
-                                                 m_rect);
-            }
+            draw_op_list_cached (theme, op_list, style_gtk, cr,
+                                 &draw_info, &rect);
         }
 
       cairo_restore (cr);
@@ -4800,18 +5933,8 @@ meta_frame_style_draw_with_style (MetaFrameStyle          *style,
                   cairo_clip (cr);
 
                   if (gdk_cairo_get_clip_rectangle (cr, NULL))
-                    {
-                      MetaRectangle m_rect;
-
-                      m_rect = meta_rect (rect.x, rect.y,
-                                          rect.width, rect.height);
-
-                      meta_draw_op_list_draw_with_style (op_list,
-                                                         style_gtk,
-                                                         cr,
-                                                         &draw_info,
-                                                         m_rect);
-                    }
+                    draw_op_list_cached (theme, op_list, style_gtk, cr,
+                                         &draw_info, &rect);
 
                   cairo_restore (cr);
                 }
@@ -5062,6 +6185,98 @@ meta_theme_get_current (void)
   return meta_current_theme;
 }
 
+/* Themes we switched away from, most recent first, kept so that going
+ * back to one doesn't mean parsing it again.
+ */
+#define MAX_RETIRED_THEMES 2
+static GList *retired_themes = NULL;
+
+/* Whether loading the theme again would give the same result: the
+ * lookup still finds the file it was loaded from, and neither that file
+ * nor the images it loaded have been modified since.
+ */
+static gboolean
+theme_files_unchanged (MetaTheme *theme)
+{
+  GHashTableIter iter;
+  gpointer key, value;
+  char *theme_file;
+  gboolean same_file;
+
+  theme_file = meta_theme_find_file (theme->name);
+  same_file = g_strcmp0 (theme_file, theme->filename) == 0;
+  g_free (theme_file);
+
+  if (!same_file)
+    {
+      meta_topic (META_DEBUG_THEMES, "Theme \"%s\" is not found in %s anymore\n",
+                  theme->name, theme->filename);
+      return FALSE;
+    }
+
+  if (meta_theme_get_file_mtime (theme->filename) != theme->mtime)
+    {
+      meta_topic (META_DEBUG_THEMES, "Theme file %s changed since it was loaded\n",
+                  theme->filename);
+      return FALSE;
+    }
+
+  g_hash_table_iter_init (&iter, theme->image_mtimes);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+      if (meta_theme_get_file_mtime (key) != *(gint64 *) value)
+        {
+          meta_topic (META_DEBUG_THEMES, "Theme image %s changed since it was loaded\n",
+                      (char *) key);
+          return FALSE;
+        }
+    }
+
+  return TRUE;
+}
+
+static MetaTheme*
+take_retired_theme (const char *name)
+{
+  GList *l;
+
+  for (l = retired_themes; l != NULL; l = l->next)
+    {
+      MetaTheme *theme = l->data;
+
+      if (strcmp (theme->name, name) != 0)
+        continue;
+
+      retired_themes = g_list_delete_link (retired_themes, l);
+
+      if (theme_files_unchanged (theme))
+        return theme;
+
+      meta_theme_free (theme);
+      break;
+    }
+
+  return NULL;
+}
+
+static void
+retire_theme (MetaTheme *theme)
+{
+  GList *last;
+
+  meta_theme_clear_piece_cache (theme);
+  image_cache_clear (theme);
+
+  retired_themes = g_list_prepend (retired_themes, theme);
+
+  if (g_list_length (retired_themes) > MAX_RETIRED_THEMES)
+    {
+      last = g_list_last (retired_themes);
+      meta_theme_free (last->data);
+      retired_themes = g_list_delete_link (retired_themes, last);
+    }
+}
+
 void
 meta_theme_set_current (const char *name)
 {
@@ -5075,7 +6290,11 @@ meta_theme_set_current (const char *name)
     return;
   
   err = NULL;
-  new_theme = meta_theme_load (name, &err);
+  new_theme = take_retired_theme (name);
+  if (new_theme != NULL)
+    meta_topic (META_DEBUG_THEMES, "Reusing already loaded theme \"%s\"\n", name);
+  else
+    new_theme = meta_theme_load (name, &err);
 
   if (new_theme == NULL)
     {
@@ -5086,7 +6305,7 @@ meta_theme_set_current (const char *name)
   else
     {
       if (meta_current_theme)
-        meta_theme_free (meta_current_theme);
+        retire_theme (meta_current_theme);
 
       meta_current_theme = new_theme;
 
@@ -5110,6 +6329,12 @@ meta_theme_new (void)
                            g_str_equal,
                            g_free,
                            (GDestroyNotify) g_object_unref);
+
+  theme->image_mtimes =
+    g_hash_table_new_full (g_str_hash,
+                           g_str_equal,
+                           g_free,
+                           g_free);
   
   theme->layouts_by_name =
     g_hash_table_new_full (g_str_hash,
@@ -5179,6 +6404,8 @@ meta_theme_free (MetaTheme *theme)
     g_hash_table_destroy (theme->integer_constants);
   if (theme->images_by_filename)
     g_hash_table_destroy (theme->images_by_filename);
+  if (theme->image_mtimes)
+    g_hash_table_destroy (theme->image_mtimes);
   if (theme->layouts_by_name)
     g_hash_table_destroy (theme->layouts_by_name);
   if (theme->draw_op_lists_by_name)  
@@ -5187,6 +6414,13 @@ meta_theme_free (MetaTheme *theme)
     g_hash_table_destroy (theme->styles_by_name);
   if (theme->style_sets_by_name)  
     g_hash_table_destroy (theme->style_sets_by_name);
+  if (theme->piece_cache)
+    g_hash_table_destroy (theme->piece_cache);
+  if (theme->image_cache)
+    {
+      image_cache_clear (theme);
+      g_hash_table_destroy (theme->image_cache);
+    }
 
   for (i = 0; i < META_FRAME_TYPE_LAST; i++)
     if (theme->style_sets_by_type[i])
@@ -5262,6 +6496,39 @@ meta_theme_validate (MetaTheme *theme,
   return TRUE;
 }
 
+/**
+ * meta_theme_get_file_mtime: (skip)
+ * @filename: a file
+ *
+ * Return value: the modification time of @filename in microseconds,
+ *   as precise as the file system keeps it, or -1 if it can't be
+ *   found out
+ */
+gint64
+meta_theme_get_file_mtime (const char *filename)
+{
+  GFile *file;
+  GFileInfo *info;
+  gint64 mtime;
+
+  file = g_file_new_for_path (filename);
+  info = g_file_query_info (file,
+                            G_FILE_ATTRIBUTE_TIME_MODIFIED ","
+                            G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC,
+                            G_FILE_QUERY_INFO_NONE,
+                            NULL, NULL);
+  g_object_unref (file);
+
+  if (info == NULL)
+    return -1;
+
+  mtime = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED) * G_USEC_PER_SEC +
+          g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+  g_object_unref (info);
+
+  return mtime;
+}
+
 /**
  * meta_theme_load_image: (skip)
  *
@@ -5294,16 +6561,24 @@ meta_theme_load_image (MetaTheme  *theme,
       else
         {
           char *full_path;
+          gint64 *mtime;
+
           full_path = g_build_filename (theme->dirname, filename, NULL);
+
+          /* Before reading, like the theme file itself */
+          mtime = g_new (gint64, 1);
+          *mtime = meta_theme_get_file_mtime (full_path);
       
           pixbuf = gdk_pixbuf_new_from_file (full_path, error);
           if (pixbuf == NULL)
             {
+              g_free (mtime);
               g_free (full_path);
               return NULL;
             }
-      
-          g_free (full_path);
+
+          /* Takes full_path */
+          g_hash_table_replace (theme->image_mtimes, full_path, mtime);
         }      
       g_hash_table_replace (theme->images_by_filename,
                             g_strdup (filename),
@@ -5507,7 +6782,8 @@ meta_theme_draw_frame (MetaTheme              *theme,
                                    &fgeom,
                                    theme);  
 
-  meta_frame_style_draw_with_style (style,
+  meta_frame_style_draw_with_style (theme,
+                                    style,
                                     style_gtk,
                                     cr,
                                     &fgeom,
@@ -6318,6 +7594,50 @@ meta_gtk_arrow_from_string (const char *str)
     return -1;
 }
 
+/**
+ * meta_draw_type_to_string: (skip)
+ * @type: a draw op type
+ *
+ * Return value: the theme file element for a draw op of @type
+ */
+const char*
+meta_draw_type_to_string (MetaDrawType type)
+{
+  switch (type)
+    {
+    case META_DRAW_LINE:
+      return "line";
+    case META_DRAW_RECTANGLE:
+      return "rectangle";
+    case META_DRAW_ARC:
+      return "arc";
+    case META_DRAW_CLIP:
+      return "clip";
+    case META_DRAW_TINT:
+      return "tint";
+    case META_DRAW_GRADIENT:
+      return "gradient";
+    case META_DRAW_IMAGE:
+      return "image";
+    case META_DRAW_GTK_ARROW:
+      return "gtk_arrow";
+    case META_DRAW_GTK_BOX:
+      return "gtk_box";
+    case META_DRAW_GTK_VLINE:
+      return "gtk_vline";
+    case META_DRAW_ICON:
+      return "icon";
+    case META_DRAW_TITLE:
+      return "title";
+    case META_DRAW_OP_LIST:
+      return "include";
+    case META_DRAW_TILE:
+      return "tile";
+    }
+
+  return "<unknown>";
+}
+
 /**
  * meta_image_fill_type_from_string:
  * @str: a string representing a fill_type
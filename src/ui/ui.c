@@ -333,6 +333,14 @@ meta_ui_get_frame_mask (MetaUI  *ui,
   meta_frames_get_mask (ui->frames, frame_xwindow, width, height, cr);
 }
 
+void
+meta_ui_paint_frame (MetaUI  *ui,
+                     Window   frame_xwindow,
+                     cairo_t *cr)
+{
+  meta_frames_paint_frame (ui->frames, frame_xwindow, cr);
+}
+
 void
 meta_ui_get_frame_borders (MetaUI *ui,
                            Window frame_xwindow,
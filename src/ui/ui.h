@@ -73,6 +73,10 @@ void meta_ui_get_frame_mask (MetaUI *ui,
                              guint height,
                              cairo_t *cr);
 
+void meta_ui_paint_frame (MetaUI *ui,
+                          Window frame_xwindow,
+                          cairo_t *cr);
+
 Window meta_ui_create_frame_window (MetaUI *ui,
                                     Display *xdisplay,
                                     Visual *xvisual,